@@ -103,6 +103,11 @@
  */
 #define MAX_HEAP_SIZE (1ull*(1ull<<40)) /* 1 TB */
 
+/*
+ * Bytes of the reservation above the brk heap set aside for mm_mmap regions
+ */
+#define MAX_MAP_SIZE (MAX_HEAP_SIZE/2)
+
 
 /***************** Parameters for looking up reference throughput *********/
 /*
@@ -0,0 +1,106 @@
+/*
+ * hugetest - checks that requests no blk can hold fail cleanly
+ *
+ * Sizes near SIZE_MAX wrap around when a header and page rounding are added to them, so a
+ * careless size computation hands back a tiny blk for them. Each huge malloc must return null
+ * and each huge realloc must return null and leave the old blk and its payload alone, for blks
+ * of every kind: slab slots, heap blks, grown heap blks and mapped blks.
+ * The sizes are built from DSIZE, the page size and MMAP_THRESHOLD, so mm.c is included rather than linked.
+ */
+#include "mm.c"
+
+#define STAMP 0x5a
+
+static int failures;
+
+static void expect(bool ok, const char *what, size_t size)
+{
+	if(!ok)
+	{
+		printf("FAIL: %s of %zu bytes\n", what, size);
+		failures ++;
+	}
+}
+
+/*a blk of size bytes filled with STAMP*/
+static char *stamped(size_t size)
+{
+	char *p = malloc(size);
+	if(p != NULL)
+	{
+		memset(p, STAMP, size);
+	}
+	return p;
+}
+
+static bool still_stamped(const char *p, size_t size)
+{
+	for(size_t i = 0; i < size; i++)
+	{
+		if(p[i] != STAMP)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(void)
+{
+	const size_t huge[] = {
+		SIZE_MAX,
+		SIZE_MAX - DSIZE,
+		SIZE_MAX - DSIZE - mm_pagesize() + 1,
+		SIZE_MAX - 2*mm_pagesize(),
+		SIZE_MAX/2 + 1,
+	};
+	const size_t nhuge = sizeof(huge)/sizeof(huge[0]);
+
+	mem_init();
+	if(!mm_init())
+	{
+		fprintf(stderr, "mm_init failed\n");
+		return 1;
+	}
+
+	for(size_t i = 0; i < nhuge; i++)
+	{
+		expect(malloc(huge[i]) == NULL, "malloc", huge[i]);
+	}
+
+	/*one blk of each kind, the heap blk is grown twice so the next move would add headroom*/
+	const size_t sizes[] = {64, 2000, 2000, MMAP_THRESHOLD + 1};
+	char *blks[4];
+	for(size_t k = 0; k < 4; k++)
+	{
+		blks[k] = stamped(sizes[k]);
+		expect(blks[k] != NULL, "setup malloc", sizes[k]);
+		if(blks[k] == NULL)
+		{
+			return 1;
+		}
+	}
+	char *fence = malloc(2000); 		//keeps the grown blk from taking the top of the heap
+	blks[2] = realloc(blks[2], 3000);
+	blks[2] = realloc(blks[2], 4000);
+	expect(blks[2] != NULL && still_stamped(blks[2], sizes[2]), "setup realloc", 4000);
+
+	for(size_t k = 0; k < 4; k++)
+	{
+		for(size_t i = 0; i < nhuge; i++)
+		{
+			expect(realloc(blks[k], huge[i]) == NULL, "realloc", huge[i]);
+			expect(still_stamped(blks[k], sizes[k]), "payload kept by failed realloc", huge[i]);
+		}
+		free(blks[k]);
+	}
+	free(fence);
+
+	if(failures)
+	{
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("huge requests fail cleanly\n");
+	return 0;
+}
@@ -121,6 +121,10 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util;       /* space utilization for this trace (always 0 for libc) */
+    size_t peak_heap;  /* largest heap plus mapped bytes seen in eval_mm_util */
+    size_t final_heap; /* heap plus mapped bytes left at the end of the trace */
+    size_t sbrk_calls; /* mem_sbrk calls made during eval_mm_util */
+    size_t sbrk_bytes; /* bytes those calls added to the heap */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t;
@@ -217,7 +221,7 @@ static void eval_libc_speed(void *ptr);
 /* Routines for evaluating correctnes, space utilization, and speed
    of the student's malloc package in mm.c */
 static bool eval_mm_valid(trace_t *trace, range_set_t *ranges);
-static double eval_mm_util(trace_t *trace, int tracenum);
+static double eval_mm_util(trace_t *trace, int tracenum, stats_t *stats);
 static void eval_mm_speed(void *ptr);
 
 /* Various helper routines */
@@ -283,7 +287,7 @@ static void run_tests(int num_tracefiles, const char *tracedir,
         if (mm_stats[i].valid) {
             if (verbose > 1)
                 printf("efficiency, ");
-            mm_stats[i].util = eval_mm_util(trace, i);
+            mm_stats[i].util = eval_mm_util(trace, i, &mm_stats[i]);
             speed_params->trace = trace;
             speed_params->ranges = ranges;
             if (verbose > 1)
@@ -691,11 +695,12 @@ static bool add_range(range_set_t *ranges, char *lo, size_t size,
         return false;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
-        (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap or of one mapped region */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
+         (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+        !mem_is_mapped(lo, size)) {
         malloc_error(trace, opnum,
-                     "Payload (%p:%p) lies outside heap (%p:%p)",
+                     "Payload (%p:%p) lies outside heap (%p:%p) and mapped regions",
                      lo, hi, mem_heap_lo(), mem_heap_hi());
         return false;
     }
@@ -1165,13 +1170,14 @@ static bool eval_mm_valid(trace_t *trace, range_set_t *ranges)
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the
  *   size of the heap in bytes after running the student's malloc
- *   package on the trace. Note that our implementation of mem_sbrk()
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap.
+ *   package on the trace, plus whatever it has mapped with mm_mmap().
+ *   Since mem_sbrk() can now decrement the brk pointer, the high water
+ *   mark of the heap is tracked after every request. Both it and the
+ *   size left at the end of the trace are stored in stats.
  *
  *   A higher number is better: 1 is optimal.
  */
-static double eval_mm_util(trace_t *trace, int tracenum)
+static double eval_mm_util(trace_t *trace, int tracenum, stats_t *stats)
 {
     int i;
     int index;
@@ -1250,10 +1256,14 @@ static double eval_mm_util(trace_t *trace, int tracenum)
         /* update the high-water mark */
         max_total_size = (total_size > max_total_size) ?
             total_size : max_total_size;
-        heap_size = mem_heapsize();
+        heap_size = mem_heapsize() + mem_mapsize();
         max_heap_size = (heap_size > max_heap_size) ?
             heap_size : max_heap_size;
     }
+    stats->peak_heap = max_heap_size;
+    stats->final_heap = mem_heapsize() + mem_mapsize();
+    stats->sbrk_calls = mem_sbrk_calls();
+    stats->sbrk_bytes = mem_sbrk_bytes();
 
 #if !REF_ONLY
     printf(".");
@@ -1442,8 +1452,8 @@ static void printresults(int n, stats_t *stats, sum_stats_t *sumstats)
     if (tab_mode) {
         printf("valid\tthru?\tutil?\tutil\tops\tmsecs\tKops\ttrace\n");
     } else {
-        printf("  %5s  %6s %7s%8s%8s  %s\n",
-               "valid", "util", "ops", "msecs", "Kops", "trace");
+        printf("  %5s  %6s%9s%9s%7s%9s %7s%8s%8s  %s\n",
+               "valid", "util", "peakKB", "finalKB", "sbrks", "sbrkKB", "ops", "msecs", "Kops", "trace");
     }
     for (i=0; i < n; i++) {
         if (stats[i].valid) {
@@ -1486,9 +1496,11 @@ static void printresults(int n, stats_t *stats, sum_stats_t *sumstats)
                 /* print '--' if util isn't weighted */
                 if (stats[i].weight == WNONE || stats[i].weight == WALL
                     || stats[i].weight == WUTIL)
-                    printf(" %7.1f%%", stats[i].util * 100.0);
+                    printf(" %7.1f%%%9zu%9zu%7zu%9zu", stats[i].util * 100.0,
+                           stats[i].peak_heap/1024, stats[i].final_heap/1024,
+                           stats[i].sbrk_calls, stats[i].sbrk_bytes/1024);
                 else
-                    printf(" %8s", "--");
+                    printf(" %8s%9s%9s%7s%9s", "--", "--", "--", "--", "--");
             }
 
             /* Ops + Time */
@@ -1524,13 +1536,17 @@ static void printresults(int n, stats_t *stats, sum_stats_t *sumstats)
             if (tab_mode) {
                 printf("no\t\t\t\t\t\t\t%s\n", stats[i].filename);
             } else {
-                printf("%2s%4s%7s%10s%7s%10s %s\n",
+                printf("%2s%4s%7s%9s%9s%7s%9s%10s%7s%10s %s\n",
                        stats[i].weight != 0 ? "*" : "",
                        "no",
                        "-",
                        "-",
                        "-",
                        "-",
+                       "-",
+                       "-",
+                       "-",
+                       "-",
                        stats[i].filename);
             }
         }
@@ -1552,10 +1568,11 @@ static void printresults(int n, stats_t *stats, sum_stats_t *sumstats)
             printf("Avg\t\t\t%.1f\t\t\t%.0f\n",
                    util, tput);
         } else {
-            printf("%2d %2d  %7.1f%%%8.0f%10.3f%7.0f\n",
+            printf("%2d %2d  %7.1f%%%34s%8.0f%10.3f%7.0f\n",
                    sum_util_weight,
                    sum_perf_weight,
                    util,
+                   "",
                    sumops,
                    sumsecs * 1000.0,
                    tput);
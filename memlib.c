@@ -22,26 +22,56 @@
 static unsigned char *heap;                 /* Starting address of heap */
 static unsigned char *mem_brk;              /* Current position of break */
 static unsigned char *mem_max_addr;         /* Maximum allowable heap address */
+static size_t sbrk_calls;                   /* Successful mm_sbrk calls since the last reset */
+static size_t sbrk_bytes;                   /* Bytes those calls added to the heap */
+
+/* mm_mmap regions are handed out upward from map_base, above mem_max_addr */
+typedef struct {
+    unsigned char *lo;                      /* First byte of the region */
+    size_t len;                             /* Length, a multiple of the page size */
+} region_t;
+
+static unsigned char *map_base;             /* Start of the mapping area */
+static unsigned char *map_brk;              /* Next never used mapping address */
+static unsigned char *map_max_addr;         /* End of the mapping area */
+static size_t map_bytes;                    /* Bytes currently mapped */
+static region_t *regions;                   /* Live regions sorted by address */
+static size_t num_regions;
+static size_t max_regions;
+
+static region_t *find_region(const void *addr);
 
 /* 
  * mm_sbrk - simple model of the sbrk function. Extends the heap 
  *           by incr bytes and returns the start address of the
- *           new area. In this model, the heap cannot be shrunk.
+ *           new area. A negative incr shrinks the heap, the whole
+ *           pages given back are dropped right away.
  */
 void *mm_sbrk(intptr_t incr) {
     unsigned char *old_brk = mem_brk;
 
     bool ok = true;
-    if (incr < 0) {
+    if (incr < 0 && (size_t) -incr > (size_t)(mem_brk - heap)) {
 	ok = false;
-	fprintf(stderr, "ERROR: mm_sbrk failed.  Attempt to expand heap by negative value %ld\n", (long) incr);
-    } else if (mem_brk + incr > mem_max_addr) {
+	fprintf(stderr, "ERROR: mm_sbrk failed.  Attempt to shrink heap by %ld bytes below its start\n", (long) -incr);
+    } else if (incr > 0 && (size_t) incr > (size_t)(mem_max_addr - mem_brk)) {
 	ok = false;
 	long alloc = mem_brk - heap + incr;
 	fprintf(stderr, "ERROR: mm_sbrk failed. Ran out of memory.  Would require heap size of %zd (0x%zx) bytes\n", alloc, alloc);
     }
+    if (ok && incr < 0) {
+	size_t page = mem_pagesize();
+	unsigned char *lo = (unsigned char *)(((uintptr_t)(mem_brk + incr) + page - 1) & ~(uintptr_t)(page - 1));
+	if (lo < mem_brk && madvise(lo, mem_brk - lo, MADV_DONTNEED) != 0) {
+	    fprintf(stderr, "FAILURE.  madvise couldn't release the trimmed heap\n");
+	    exit(1);
+	}
+    }
     if (ok) {
 	mem_brk += incr;
+	sbrk_calls++;
+	if (incr > 0)
+	    sbrk_bytes += incr;
 	return (void *) old_brk;
     } else {
 	errno = ENOMEM;
@@ -49,6 +79,83 @@ void *mm_sbrk(intptr_t incr) {
     }
 }
 
+/*
+ * mm_mmap - simple model of an anonymous mmap. Returns a fresh page
+ *           aligned region of len bytes, rounded up to whole pages,
+ *           that lies outside the brk heap. Addresses are never reused.
+ */
+void *mm_mmap(size_t len) {
+    size_t page = mem_pagesize();
+    len = (len + page - 1) & ~(page - 1);
+
+    if (len == 0 || len > (size_t)(map_max_addr - map_brk)) {
+	fprintf(stderr, "ERROR: mm_mmap failed. Ran out of mapping space for %zd (0x%zx) bytes\n", len, len);
+	errno = ENOMEM;
+	return (void *) -1;
+    }
+    if (num_regions == max_regions) {
+	max_regions = max_regions ? 2*max_regions : 64;
+	if ((regions = realloc(regions, max_regions*sizeof(region_t))) == NULL) {
+	    fprintf(stderr, "FAILURE.  realloc couldn't grow the region table\n");
+	    exit(1);
+	}
+    }
+    region_t *r = &regions[num_regions++];
+    r->lo = map_brk;
+    r->len = len;
+    map_brk += len;
+    map_bytes += len;
+    return (void *) r->lo;
+}
+
+/*
+ * mm_munmap - releases a whole region returned by mm_mmap. Its pages
+ *             are dropped right away. Returns 0 on success, -1 on error.
+ */
+int mm_munmap(void *addr, size_t len) {
+    size_t page = mem_pagesize();
+    region_t *r = find_region(addr);
+
+    len = (len + page - 1) & ~(page - 1);
+    if (r == NULL || r->lo != addr || r->len != len) {
+	fprintf(stderr, "ERROR: mm_munmap failed. %p:%zd is not a mapped region\n", addr, len);
+	errno = EINVAL;
+	return -1;
+    }
+    if (madvise(addr, len, MADV_DONTNEED) != 0) {
+	fprintf(stderr, "FAILURE.  madvise couldn't release a mapped region\n");
+	exit(1);
+    }
+    map_bytes -= len;
+    num_regions--;
+    memmove(r, r + 1, (size_t)(&regions[num_regions] - r)*sizeof(region_t));
+    return 0;
+}
+
+/*
+ * mm_mapsize - returns the number of bytes currently mapped by mm_mmap
+ */
+size_t mm_mapsize() {
+    return map_bytes;
+}
+
+/*
+ * find_region - returns the live region holding addr, or NULL
+ */
+static region_t *find_region(const void *addr) {
+    size_t lo = 0, hi = num_regions;
+    while (lo < hi) {
+	size_t mid = (lo + hi)/2;
+	if ((const unsigned char *) addr < regions[mid].lo)
+	    hi = mid;
+	else if ((const unsigned char *) addr >= regions[mid].lo + regions[mid].len)
+	    lo = mid + 1;
+	else
+	    return &regions[mid];
+    }
+    return NULL;
+}
+
 /*
  * mm_heap_lo - return address of the first heap byte
  */
@@ -137,7 +244,9 @@ void mem_init(){
 	exit(1);
     }
     heap = addr;
-    mem_max_addr = addr + MAX_HEAP_SIZE;
+    mem_max_addr = addr + MAX_HEAP_SIZE - MAX_MAP_SIZE;
+    map_base = mem_max_addr;
+    map_max_addr = addr + MAX_HEAP_SIZE;
     mem_reset_brk();
 }
 
@@ -149,13 +258,26 @@ void mem_deinit(void){
         fprintf(stderr, "FAILURE.  munmap couldn't deallocate heap space\n");
         exit(1);
     }
+    free(regions);
+    regions = NULL;
+    num_regions = max_regions = 0;
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointer to make an empty heap,
+ *                 dropping every mapped region along with it
  */
 void mem_reset_brk(){
     mem_brk = heap;
+    sbrk_calls = 0;
+    sbrk_bytes = 0;
+    if (map_brk > map_base && madvise(map_base, map_brk - map_base, MADV_DONTNEED) != 0) {
+	fprintf(stderr, "FAILURE.  madvise couldn't release the mapping area\n");
+	exit(1);
+    }
+    map_brk = map_base;
+    map_bytes = 0;
+    num_regions = 0;
 }
 
 void *mem_sbrk(intptr_t incr) {
@@ -178,6 +300,30 @@ size_t mem_pagesize(){
     return (size_t) getpagesize();
 }
 
+size_t mem_mapsize() {
+    return map_bytes;
+}
+
+/*
+ * mem_sbrk_calls, mem_sbrk_bytes - successful mm_sbrk calls and the
+ *     bytes they added since the last mem_reset_brk
+ */
+size_t mem_sbrk_calls() {
+    return sbrk_calls;
+}
+
+size_t mem_sbrk_bytes() {
+    return sbrk_bytes;
+}
+
+/*
+ * mem_is_mapped - true if the size bytes at lo lie within one live mapped region
+ */
+bool mem_is_mapped(const void *lo, size_t size) {
+    region_t *r = find_region(lo);
+    return r != NULL && (const unsigned char *) lo + size <= r->lo + r->len;
+}
+
 /* Read len bytes and return value zero-extended to 64 bits */
 uint64_t mem_read(const void *addr, size_t len) {
     uint64_t rdata;
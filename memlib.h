@@ -5,6 +5,9 @@
 /* Support routines */
 
 void *mm_sbrk(intptr_t incr);
+void *mm_mmap(size_t len);
+int mm_munmap(void *addr, size_t len);
+size_t mm_mapsize(void);
 void *mm_heap_lo(void);
 void *mm_heap_hi(void);
 size_t mm_heapsize(void);
@@ -23,6 +26,10 @@ void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
 size_t mem_pagesize(void);
+size_t mem_mapsize(void);
+size_t mem_sbrk_calls(void);
+size_t mem_sbrk_bytes(void);
+bool mem_is_mapped(const void *lo, size_t size);
 
 /* Read len bytes and return value zero-extended to 64 bits */
 /* Require 0 <= len <= 8 */
@@ -4,26 +4,51 @@
  * Name: Youssef Shoala
  *
  * General:
- * Each block has a header and footer with the size and the alloc bit
+ * Each block has a header with the size, the alloc bit and a prev alloc bit, only free blocks also have a footer
+ * Mini blocks (16 bytes, payloads of 8 bytes or less) have no room for a footer or a prev link, they sit in
+ * a singly linked list 0 and the block after them has a prev mini bit so coalesce can still find them
+ * Requests up to SLAB_MAX_SIZE bytes skip all of the above, they are slots in page sized runs carved from the heap,
+ * each run serves one slot size and tracks its slots in a bitmap so small objects have no header at all
+ * Requests over MMAP_THRESHOLD bytes get their own region from mm_mmap() outside the heap, freeing one unmaps it
+ * right away instead of leaving a hole, they are told apart from heap blks by their address
+ * Free blocks of class TREE_CLASS and up are not kept in lists but in one splay tree keyed on (size, address)
+ * whose node links live in the free block payload, so large fits are best fit in O(log n) amortised
+ * Free blocks of the mixed size classes below the tree sit in side tables mapped outside the heap, packed arrays
+ * of sizes and addresses, so their fit search reads dense memory instead of following links through cold blocks
+ * The compact build (-DCOMPACT_HEAP) shrinks headers, footers and free list links to 4 bytes for heaps under 2GB
+ * The thread safe build (-DTHREAD_SAFE) puts each slab class behind a lock of its own and the rest of the heap behind one,
+ * heap size classes share that lock because coalescing and splitting move blks between them (see THREAD_SAFE below),
+ * the slab layer is split into arenas that threads spread over so they rarely want the same class lock,
+ * and every thread caches slots of each slab class so most small requests never get that far
  * HEAP***PrologueHDR  PrologueFTR  Epilogue
  *                   ^            ^
  *                   |            |
  *               hepalistp    new blks here
  * 
  * Malloc:
- * My solution uses 14 free lists to track a variety of sizes that can be changed in the find_freelist() function. 
- * The idea is that we search through the appropriate sized freelist to find a free blk, the lists are sorted by increasing size and the first block that has enough size is returned when looking for a block. Keeping track of only freeblks increases throughput drastically. Multiple freelists help with both throughput and util
- * If no free blk is found then the heap is extended using sbrk and the new blk that's made is the freeblk that is used for the alloc
+ * Requests up to SLAB_MAX_SIZE bytes take a slot from a run of their slab class, the 32-128 byte slot sizes pop a LIFO quick list first
+ * Requests over MMAP_THRESHOLD bytes are mapped on their own, everything in between is a heap blk
+ * My solution uses 14 free lists to track a variety of sizes, the size class table is set at build time (NUM_FREELISTS, LINEAR_CLASS_LIMIT, CLASS_LOG_STEP) and size_class() maps a size to its list with a clz and a shift. 
+ * A heap request first takes a pending blk (see Free) that fits without a split, then looks up the exact fit index, then searches its class:
+ * the list, side table or tree of that class, then the next nonempty larger class through the bitmap. Keeping track of only freeblks increases throughput drastically
+ * A miss flushes the pending blks and then the quick lists and looks again, small fits are carved off the high end of a free blk
+ * If still no free blk is found the request is bump allocated from the wilderness, the free blk at the top of the heap that no list holds,
+ * and the heap is only extended by sbrk when the wilderness is too small, by a chunk that grows while misses keep coming
  * 
  * Free:
- * Will only change the hdr and ftr alloc bit to 0 to display it is free
- * Coalescing is implemented and the freelist will update after it has coalesced if the new coalesced block belongs in a different freelist
+ * Mapped blks are unmapped and slab slots go back to their quick list or their run, a run that empties goes back to the heap unless it is the last of its class with room
+ * A heap blk is not coalesced right away, it stays marked allocated on a pending list so a malloc of the same size can take it back as is
+ * When PENDING_MAX blks pile up, an allocation misses, mm_trim() runs or a blk next to the top of the heap is freed, the pending blks are
+ * sorted by address, neighbours are merged and each run is coalesced with the free blks around it and put in its freelist or the wilderness
  * For internal fragmentation, the place funtion will never leave unused space in a block, instead it will turn that remaining space into a new freeblk
+ * A free top of the heap over TRIM_THRESHOLD bytes is given back with a negative sbrk, keeping TRIM_PAD bytes
  * 
  * Realloc:
  * Assuming both parameters are valid, realloc will either:
- * 		return the same blkp with a new size smaller than the original size of the blk
- * 		call malloc to get a freeblk that can fit the specified size, then free the old ptr
+ * 		return the same ptr when a mapped blk or slab slot still fits the new size, or a heap blk shrinks, splitting off the rest
+ * 		grow a heap blk in place into a free next blk, the top of the heap or, moving the payload down once, a free prev blk
+ * 		call malloc to get a blk that can fit the specified size, copy the payload, then free the old ptr
+ * A heap blk realloc has grown is marked, while it keeps growing a move gives it 1/GROW_HEADROOM extra so the next growth can stay put
  */
 #include <assert.h>
 #include <stdlib.h>
@@ -34,6 +59,9 @@
 #include <stdbool.h>
 #include "mm.h"
 #include "memlib.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include <time.h>
 
@@ -41,13 +69,16 @@
  * If you want to enable your debugging output and heap checker code,
  * uncomment the following line. Be sure not to have debugging enabled
  * in your final submission.
+ * Programs that compile mm.c in whole (scanbench, threadbench) build with -DNDEBUG_PRINT to keep it quiet
  */
 
 
 
 
 
+#ifndef NDEBUG_PRINT
 #define DEBUG
+#endif
 
 
 
@@ -75,7 +106,247 @@
 #define ALIGNMENT 16
 #define WSIZE 8
 #define DSIZE 16
-#define CHINKSIZE (1<<12)
+#define CHINKSIZE (1<<12)	//the heap grows by whole chunks of this many bytes
+#define PREV_ALLOC 0x2		//header bit set when the previous block is allocated
+#define PREV_MINI 0x4		//header bit set when the previous block is a mini block
+#define MINI_BLK_SIZE DSIZE	//mini blocks are a header and one word, they only ever live in list 0
+
+/*
+ * Compact build (-DCOMPACT_HEAP): headers and footers are 4 bytes and free list links are 32 bit offsets
+ * from the bottom of the heap, so a free blk carries 16 bytes of metadata instead of 32 and a mini blk
+ * holds 12 bytes of payload. Header sizes and link offsets have to fit 31 bits, so the heap stops
+ * growing at COMPACT_HEAP_MAX, mapped blks live outside it and keep their length in a full word
+ */
+#ifdef COMPACT_HEAP
+typedef uint32_t hdr_t; 
+#define HSIZE 4							//header and footer bytes
+#define COMPACT_HEAP_MAX ((size_t)1 << 31)	//bytes the heap, meta included, may span
+#else
+typedef uint64_t hdr_t; 
+#define HSIZE WSIZE
+#endif
+#define GROWN_BLK ((hdr_t)1 << (8*HSIZE - 1))	//header bit set on an allocated blk that realloc has grown, sizes never get near it
+#define GROW_HEADROOM 2		//a grown blk that grows again gets 1/GROW_HEADROOM of its new size as headroom
+
+/*
+ * Size class table, every value can be overridden at build time with -D
+ * sizes below LINEAR_CLASS_LIMIT get one list per ALIGNMENT step,
+ * past that every list covers (1<<CLASS_LOG_STEP) times the range of the previous one,
+ * the last list takes everything that is left
+ * defaults give {0, 32, 48, 64, 80, 96, 112, 128, 512, 2048, 8192, 32768, 131072, 524288} //half +16 half pow4
+ */
+#ifndef NUM_FREELISTS
+#define NUM_FREELISTS 14
+#endif
+#ifndef LINEAR_CLASS_LIMIT
+#define LINEAR_CLASS_LIMIT 128
+#endif
+#ifndef CLASS_LOG_STEP
+#define CLASS_LOG_STEP 2
+#endif
+#define NUM_LINEAR_CLASSES (LINEAR_CLASS_LIMIT/ALIGNMENT - 1)
+#ifndef TREE_CLASS
+#ifdef PLACEMENT_AOFF
+#define TREE_CLASS NUM_FREELISTS	//address ordered first fit keeps every class in a list, there is no tree
+#else
+#define TREE_CLASS 8		//lists from this class up are replaced by one best fit tree
+#endif
+#endif
+#if NUM_FREELISTS > 64
+#error "NUM_FREELISTS must fit in the 64 bit nonempty_lists bitmap"
+#endif
+
+/*
+ * Placement engine, build with -DPLACEMENT_TLSF (make tlsf) to swap the segregated lists and best fit tree
+ * for Two-Level Segregated Fit: every malloc and free is a fixed number of bitmap ops and list splices
+ * TLSF needs both links in every free blk for O(1) removal, so it has no mini blocks
+ * -DPLACEMENT_AOFF (make aoff) has no tree, the fit search is address ordered first fit, which fragments less over long runs
+ * the one size lists are kept sorted by address and a free walks its list to its place, O(n) per free,
+ * the mixed classes stay in their unsorted side tables and a search scans the whole table for the lowest fit, O(n) per malloc
+ * only a merge that keeps a blk in its class could take its old neighbour's place in O(1), and that only happens
+ * in the side table classes, where splice_freeblk() does it
+ */
+#ifdef PLACEMENT_TLSF
+#ifndef TLSF_SL_LOG
+#define TLSF_SL_LOG 3		//log2 of the number of second level lists per power of two
+#endif
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG)
+#define ALIGNMENT_LOG 4
+#define TLSF_FL_SHIFT (TLSF_SL_LOG + ALIGNMENT_LOG)		//sizes below 1<<TLSF_FL_SHIFT are first level 0, split in ALIGNMENT steps
+#define TLSF_FL_COUNT (40 - TLSF_FL_SHIFT + 2)			//enough first levels for the 1TB MAX_HEAP_SIZE in config.h
+#define MIN_BLK_SIZE (2*DSIZE)
+#if TLSF_SL_LOG > 5
+#error "TLSF second level bitmaps are 32 bits"
+#endif
+#ifdef PLACEMENT_AOFF
+#error "PLACEMENT_TLSF and PLACEMENT_AOFF are separate placement engines"
+#endif
+#else
+#define MIN_BLK_SIZE MINI_BLK_SIZE
+#endif
+
+/*
+ * Slab runs for small requests, every request up to SLAB_MAX_SIZE bytes is a headerless slot in a page aligned run
+ * slot sizes go up in 16 byte steps to 128 then 4 steps per power of two to 512
+ */
+#ifndef SLAB_MAX_SIZE
+#define SLAB_MAX_SIZE 512
+#endif
+#if SLAB_MAX_SIZE > 512
+#error "SLAB_MAX_SIZE can be at most 512"
+#endif
+#define SLAB_CLASSES 16
+#define RUN_SIZE (1<<12)					//runs are one page and page aligned so free can find them by masking
+#define RUN_BLK_SIZE RUN_SIZE				//heap blk holding a run, its header ends the page before so runs pack back to back
+#define RUN_BLK 0x8							//header bit set on the heap blk of a run
+#define RUN_MAGIC 0x9e3779b97f4a7c15		//added to run_cookie by every mm_init
+
+/*
+ * Requests over MMAP_THRESHOLD bytes are mapped on their own, the payload sits DSIZE into the region
+ * with a header holding the region length so free knows how much to unmap
+ */
+#ifndef MMAP_THRESHOLD
+#define MMAP_THRESHOLD (1<<18)
+#endif
+
+/*
+ * A free blk at the top of the heap bigger than TRIM_THRESHOLD is given back to memlib, all but TRIM_PAD bytes of it
+ */
+#ifndef TRIM_THRESHOLD
+#define TRIM_THRESHOLD (1<<20)
+#endif
+#ifndef TRIM_PAD
+#define TRIM_PAD (1<<18)
+#endif
+
+/*
+ * Freed heap blks are not coalesced right away, they wait on a pending list until PENDING_MAX of them pile up
+ * or an allocation misses, then they are merged in one address ordered sweep, 0 coalesces on every free
+ */
+#ifndef PENDING_MAX
+#define PENDING_MAX 32
+#endif
+
+/*
+ * Split direction, place_fit() carves requests of up to SPLIT_THRESHOLD bytes off the high end of a free blk
+ * and larger ones off the low end, so small blks cluster together away from the big holes
+ * SPLIT_SMALL_HIGH 0 flips it, SPLIT_THRESHOLD 0 always carves the low end like place()
+ */
+#ifndef SPLIT_THRESHOLD
+#define SPLIT_THRESHOLD 1024
+#endif
+#ifndef SPLIT_SMALL_HIGH
+#define SPLIT_SMALL_HIGH 1
+#endif
+
+/*
+ * Heap growth, extend_heap() grows by one CHINKSIZE chunk at first and doubles the chunk every time the heap
+ * has to grow again within GROW_WINDOW mallocs of the last time, up to CHINKSIZE << GROW_MAX_SHIFT
+ * the chunk never goes over 1/GROW_HEAP_FRACTION of the heap so the unused top stays small next to it
+ */
+#ifndef GROW_WINDOW
+#define GROW_WINDOW 64
+#endif
+#ifndef GROW_MAX_SHIFT
+#define GROW_MAX_SHIFT 6
+#endif
+#ifndef GROW_HEAP_FRACTION
+#define GROW_HEAP_FRACTION 64
+#endif
+
+/*
+ * Quick lists, LIFO lists of freed slab slots of QUICK_MIN_SIZE to QUICK_MAX_SIZE bytes in ALIGNMENT steps
+ * a slot on one keeps its bit set in its run, they go back to their runs when a slab or heap allocation misses
+ */
+#define QUICK_MIN_SIZE 32
+#define QUICK_MAX_SIZE 128
+#define QUICK_CLASSES ((QUICK_MAX_SIZE - QUICK_MIN_SIZE)/ALIGNMENT + 1)
+#if QUICK_MAX_SIZE > SLAB_MAX_SIZE
+#error "quick lists hold slab slots, QUICK_MAX_SIZE can't be over SLAB_MAX_SIZE"
+#endif
+
+/*
+ * Side tables, free blks of the mixed size classes from NUM_LINEAR_CLASSES up to TREE_CLASS are not linked
+ * through the heap, their sizes and addresses sit packed in one table per class so a fit search scans dense arrays
+ * a table is mapped with SIDE_TABLE_MIN entries the first time its class gets a blk and doubles whenever it fills
+ */
+#ifndef SIDE_TABLE_MIN
+#define SIDE_TABLE_MIN 256
+#endif
+#define SIDE_CLASSES (NUM_FREELISTS - NUM_LINEAR_CLASSES)
+
+/*
+ * Exact fit index, free blks of EXACT_MIN_SIZE to EXACT_MAX_SIZE bytes are also chained by their exact size
+ * off a small open addressed table in meta, so a malloc of a size that recurs takes a blk in O(1) with no split
+ * the table has 1<<EXACT_SLOTS_LOG sizes and a size sits at most EXACT_PROBE_MAX slots past its home,
+ * a blk whose size finds no slot in that run is only in its list or tree
+ * chains are LIFO, so address ordered first fit leaves the index out and every blk is only in its list
+ */
+#ifndef EXACT_MIN_SIZE
+#define EXACT_MIN_SIZE (1<<10)
+#endif
+#ifndef EXACT_MAX_SIZE
+#define EXACT_MAX_SIZE (1<<16)
+#endif
+#ifndef EXACT_SLOTS_LOG
+#define EXACT_SLOTS_LOG 5
+#endif
+#define EXACT_SLOTS (1 << EXACT_SLOTS_LOG)
+#ifndef EXACT_PROBE_MAX
+#define EXACT_PROBE_MAX 8
+#endif
+#define EXACT_LINK_OFFSET (3*WSIZE)		//the chain links follow the tree node, TLSF links or side table index in the payload
+#if EXACT_MIN_SIZE < EXACT_LINK_OFFSET + 3*WSIZE
+#error "EXACT_MIN_SIZE blks must have room for a header, the chain links and a footer past the other links"
+#endif
+
+/*
+ * Thread safe build (-DTHREAD_SAFE), each slab class has a lock over its runs and its quick list, heap_lock covers
+ * every other heap blk and free structure and sbrk_lock covers the memlib calls, so mapped blks and slab classes
+ * that have slots don't wait for the heap. A thread holding one lock only ever takes locks later in the
+ * order class, heap, sbrk. Other builds keep the same calls but they do nothing
+ * Heap size classes get no lock of their own: a free coalesces with neighbours of any class and puts the result
+ * in another, a split leaves its rest in a smaller class, and the wilderness, pending list and exact fit index
+ * span every class, so nearly every heap call would take several class locks in some order. A slab slot never
+ * changes class, which is what lets slab classes be locked apart
+ */
+#ifdef THREAD_SAFE
+#include <sched.h>
+#include <pthread.h>
+#define SPIN_YIELD 64		//pauses a waiter spins for before it yields the cpu to whoever holds the lock
+#endif
+
+/*
+ * Arenas, the slab layer is split into NUM_ARENAS arenas with their own runs, quick lists and class locks
+ * a thread is bound to an arena round robin on its first small malloc and moves to the next arena for good when
+ * it finds its class lock held, a freed slot goes back to the arena named in its run header
+ * runs are the chunks an arena takes from the heap, heap sized blks are shared by every arena
+ */
+#ifndef NUM_ARENAS
+#ifdef THREAD_SAFE
+#define NUM_ARENAS 8
+#else
+#define NUM_ARENAS 1
+#endif
+#endif
+#if NUM_ARENAS > 65535
+#error "run headers keep the arena in 16 bits"
+#endif
+
+/*
+ * Thread caches, in the thread safe build every thread keeps up to TCACHE_MAX freed slots of each slab class
+ * in a cache of its own, so most small mallocs and frees take no lock and no atomic. An empty cache is refilled
+ * with TCACHE_BATCH slots and an overfull one hands its TCACHE_BATCH coldest back, both under one class lock
+ */
+#ifndef TCACHE_BATCH
+#define TCACHE_BATCH 32
+#endif
+#ifndef TCACHE_MAX
+#define TCACHE_MAX 64
+#endif
+#if TCACHE_BATCH > TCACHE_MAX
+#error "TCACHE_BATCH has to fit in a full cache"
+#endif
 
 
 /*Function declaration*/
@@ -86,25 +357,115 @@ void *coalesce(void *bp);
 char **find_free_list(size_t asize);
 uint64_t GET_SIZE(char *p); 
 char *HDRP(void *bp);
+static bool flush_quick(void); 
+static void flush_pending(void); 
+static void release_empty_runs(void); 
+
+
+/*
+ * Allocator bookkeeping, it lives at the bottom of the heap below the prologue
+ * so that only the pointer to it counts against the 128 byte global budget
+ */
+/*Links of a large free blk in the best fit tree, stored at the start of its payload*/
+typedef struct tnode
+{
+	struct tnode *left, *right;
+	struct tnode *parent;
+} tnode_t;
+
+/*Header at the start of every run, the slots follow it*/
+typedef struct run
+{
+	uint64_t magic; 			//run_cookie ^ address of the run, cleared when the run goes back to the heap
+	struct run *next, *prev; 	//Runs of the same slot size with at least one free slot
+	uint16_t slot_size; 
+	uint16_t arena; 			//Index of the arena whose lists the run is on
+	uint16_t nslots; 
+	uint16_t nfree; 
+	uint64_t used[4]; 			//Bit i is set while slot i is allocated
+} run_t;
+#define RUN_HDR_SIZE 64
+#define RUN_MAX_SLOTS 256
+
+/*Side table of one size class, both arrays live in one mapped region, a listed blk keeps its index in its first word*/
+typedef struct
+{
+	uint64_t *sizes; 	//sizes[i] is the size of the blk at addrs[i]
+	char **addrs; 
+	size_t count; 		//Entries in use
+	size_t cap; 		//Entries the region has room for
+} side_table_t;
+
+#ifdef THREAD_SAFE
+/*Spin lock, the class locks of an arena share one cache line, the arenas and the heap and sbrk locks have lines of their own*/
+typedef struct
+{
+	uint32_t held; 
+} mm_lock_t;
+#endif
+
+/*Slab state of one arena*/
+typedef struct
+{
+	run_t *slab_runs[SLAB_CLASSES]; 	//Runs with free slots of each slot size
+	char *quick_lists[QUICK_CLASSES]; 	//Freed slots of each quick size, linked through their first word
+#ifdef THREAD_SAFE
+	mm_lock_t slab_locks[SLAB_CLASSES] __attribute__((aligned(64))); 	//Guard slab_runs, the runs and the quick list of each slab class
+#endif
+} arena_t;
+
+#ifdef THREAD_SAFE
+/*Cache of one thread, mapped the first time the thread needs it, slots are linked through their first word*/
+typedef struct
+{
+	uint64_t cookie; 					//run_cookie of the heap the slots came from
+	char *slots[SLAB_CLASSES]; 
+	uint32_t count[SLAB_CLASSES]; 
+} tcache_t;
+#endif
+
+/*Scan of a side table size array, returns the index of the first of sizes[0..n) that is at least asize, n if none is*/
+typedef size_t (*side_scan_fn)(const uint64_t *sizes, size_t n, uint64_t asize);
 
+typedef struct
+{
+	char *freeblk_lists[NUM_FREELISTS];	//Points to the first free blk of each size class, null when empty
+	uint64_t nonempty_lists; 			//Bit i is set while freeblk_lists[i] holds at least one blk, bit TREE_CLASS stands for the tree
+	tnode_t *large_tree_root; 			//Root of the best fit tree of large free blks
+	side_table_t side_tables[SIDE_CLASSES]; 	//Free blks of each mixed size class below TREE_CLASS, see SIDE_TABLE_MIN
+	side_scan_fn side_scan; 					//Widest side table scan this CPU runs, picked by mm_init
+	uint64_t exact_sizes[EXACT_SLOTS]; 		//Size each slot of the exact fit index holds, 0 when the slot is empty
+	char *exact_heads[EXACT_SLOTS]; 		//First free blk of that exact size
+	arena_t arenas[NUM_ARENAS]; 		//Slab runs and quick lists, see NUM_ARENAS
+	char *pending; 						//Freed blks waiting to be coalesced, still marked allocated and linked through their payload
+	size_t npending; 
+	char *wilderness; 					//Free blk at the top of the heap, kept out of the lists so it is used last, or null
+	uint64_t nmalloc; 					//Calls to malloc so far, the clock the growth policy measures demand with
+	uint64_t last_grow; 				//nmalloc when the heap last grew
+	size_t grow_shift; 					//Current chunk is CHINKSIZE << grow_shift
+#ifdef PLACEMENT_TLSF
+	uint64_t tlsf_fl_bitmap; 						//Bit fl is set while any list of first level fl holds a blk
+	uint32_t tlsf_sl_bitmap[TLSF_FL_COUNT]; 		//Bit sl is set while tlsf_lists[fl][sl] holds a blk
+	char *tlsf_lists[TLSF_FL_COUNT][TLSF_SL_COUNT]; //Heads of the TLSF free lists, NULL when empty
+#endif
+#ifdef THREAD_SAFE
+	uint32_t next_arena; 					//Arena the next thread to malloc is bound to, modulo NUM_ARENAS
+	mm_lock_t heap_lock __attribute__((aligned(64))); 	//Guards the heap blks and everything above that indexes them
+	mm_lock_t sbrk_lock __attribute__((aligned(64))); 	//Guards the memlib calls
+#endif
+} heap_meta_t;
 
 /*Private global vairables */
 static char *heap_listp = 0; 		//Points to the first block in the heap
-static char *freeblk_listp = 0;     //Points to the first free blk in the heap
-static char *freeblk_listp1 = 0;	
-static char *freeblk_listp2 = 0;	
-static char *freeblk_listp3 = 0;	
-static char *freeblk_listp4 = 0;	
-static char *freeblk_listp5 = 0;	
-static char *freeblk_listp6 = 0;	
-static char *freeblk_listp7 = 0;	
-static char *freeblk_listp8 = 0;	
-static char *freeblk_listp9 = 0;	
-static char *freeblk_listp10 = 0;
-static char *freeblk_listp11 = 0;
-static char *freeblk_listp12 = 0;
-static char *freeblk_listp13 = 0;
-static char **curr_freelist = &freeblk_listp; 		//Points to the correct list given block size
+static heap_meta_t *meta = 0; 		//Points to the list heads stored at the bottom of the heap
+static uint64_t run_cookie = 0; 		//Changes every mm_init so runs left in memory by an older heap never match
+#ifdef THREAD_SAFE
+static __thread uint32_t thread_arena = 0; 	//Arena this thread allocates from plus one, 0 until it is bound
+static __thread tcache_t *thread_cache = NULL; 	//This thread's cache, null until its first small malloc or free
+static pthread_key_t tcache_key; 				//Hands every cache to tcache_release() when its thread exits
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT; 
+static void tcache_drain(tcache_t *tc, size_t class, size_t keep); 
+#endif
 
 uint64_t MAX(int x, int y)
 {
@@ -127,29 +488,44 @@ void PUT(char *p, uint64_t val)
 	(*(uint64_t *)(p) = (val));
 }
 
+/*Read and write a header or footer at address p*/
+hdr_t GET_HDR(char *p)
+{
+	return (*(hdr_t *)(p));
+}
+void PUT_HDR(char *p, hdr_t val)
+{
+	(*(hdr_t *)(p) = (val));
+}
+
+#ifdef COMPACT_HEAP
+/*Convert between a free blk and its link offset from meta at the bottom of the heap, no blk starts there so 0 is null*/
+char *LINK_TO_PTR(uint32_t off)
+{
+	return off ? (char *)meta + off : NULL; 
+}
+uint32_t PTR_TO_LINK(uint64_t val)
+{
+	return val ? (uint32_t)((char *)val - (char *)meta) : 0; 
+}
+#endif
 
-/*Read the next and prev free block pointers*/
+/*Read the next and prev free block pointers, the ends of a list are null*/
 char *GET_NEXT_FREEBLK(char *p)
 {
-	curr_freelist = find_free_list(GET_SIZE(HDRP((void *)p))); 
-	if(heap_listp == *curr_freelist)
-	{
-		return NULL; 
-	}
-	char *next_free = NULL; 
-	memcpy(&next_free, p, 8); 
-	return next_free;
+#ifdef COMPACT_HEAP
+	return LINK_TO_PTR(*(uint32_t *)p); 
+#else
+	return (char *)GET(p);
+#endif
 }
 char *GET_PREV_FREEBLK(char *p)
 {
-	curr_freelist = find_free_list(GET_SIZE(HDRP((void *)p))); 
-	if(heap_listp == *curr_freelist)
-	{
-		return NULL; 
-	}
-	char *prev_free = NULL;
-	memcpy(&prev_free, p+8, 8); 
-	return (char *)prev_free;
+#ifdef COMPACT_HEAP
+	return LINK_TO_PTR(*(uint32_t *)(p + sizeof(uint32_t))); 
+#else
+	return (char *)GET(p + WSIZE);
+#endif
 }
 
 /*Write the next and prev free block pointers*/
@@ -157,612 +533,2159 @@ void SET_NEXT_FREEBLK(char *p, uint64_t val)
 {
 	//*p = val; 
 	//memset(p, (int)val, 8); 
+#ifdef COMPACT_HEAP
+	*(uint32_t *)p = PTR_TO_LINK(val); 
+#else
 	PUT(p, val); 
+#endif
 }
 void SET_PREV_FREEBLK(char *p, uint64_t val)
 {
 	//*(p+8) = val; 
 	//memset(p+8, (int)val, 8);
+#ifdef COMPACT_HEAP
+	*(uint32_t *)(p + sizeof(uint32_t)) = PTR_TO_LINK(val); 
+#else
 	PUT(p+8, val); 
+#endif
 }
 
 /*Read the size ald allocated fields from address p*/ 
 uint64_t GET_SIZE(char *p)
 {
-	return (GET(p) & ~(DSIZE-1));
+	return (GET_HDR(p) & ~(DSIZE-1) & ~GROWN_BLK);
 }
 uint64_t GET_ALLOC(char *p)
 {
-	return (GET(p) & 0x1);
+	return (GET_HDR(p) & 0x1);
+}
+uint64_t GET_PREV_ALLOC(char *p)
+{
+	return (GET_HDR(p) & PREV_ALLOC);
+}
+uint64_t GET_PREV_MINI(char *p)
+{
+	return (GET_HDR(p) & PREV_MINI);
 }
 
-/*Given block pointer bp, compute address of its header and footer*/
+/*Given block pointer bp, compute address of its header and footer, only free blocks have a footer*/
 char *HDRP(void *bp)
 {
-	return((char *)(bp) - WSIZE);
+	return((char *)(bp) - HSIZE);
 }
 char *FTRP(void *bp)
 {
-	return ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE);
+	return ((char *)(bp) + GET_SIZE(HDRP(bp)) - 2*HSIZE);
 }
 
-/*Given block ptr bp, compute address of its header and footer*/
+/*Given block ptr bp, compute address of the next and prev blocks, PREV_BLKP is only valid if prev is free*/
 char *NEXT_BLKP(void *bp)
 {
-	return((char *)(bp) + GET_SIZE((char *)(bp) - WSIZE));
+	return((char *)(bp) + GET_SIZE((char *)(bp) - HSIZE));
 }
 char *PREV_BLKP(void *bp) 
 {
-	return((char *)(bp) - GET_SIZE((char *)(bp) - DSIZE));
+	if(GET_PREV_MINI(HDRP(bp)))
+	{
+		return((char *)(bp) - MINI_BLK_SIZE);
+	}
+	return((char *)(bp) - GET_SIZE((char *)(bp) - 2*HSIZE));
 }
 
-/*Rounds up to the nearest multiple of ALIGNMENT*/
-static size_t align(size_t x)
+/*
+ * Writes the header of bp with size and alloc keeping its prev bits, and the footer if it is a free non mini block,
+ * then mirrors the alloc and mini state of bp into the prev bits of the next block header
+ */
+void PUT_BLK(void *bp, size_t size, size_t alloc)
 {
-    return ALIGNMENT * ((x+ALIGNMENT-1)/ALIGNMENT);
+	PUT_HDR(HDRP(bp), PACK(size, alloc | (GET_HDR(HDRP(bp)) & (PREV_ALLOC | PREV_MINI)))); 
+	if(!alloc && size > MINI_BLK_SIZE)
+	{
+		PUT_HDR(FTRP(bp), PACK(size, 0)); 
+	}
+	char *next_hdrp = HDRP(NEXT_BLKP(bp)); 
+	hdr_t prev_bits = (alloc ? PREV_ALLOC : 0) | (size == MINI_BLK_SIZE ? PREV_MINI : 0); 
+	PUT_HDR(next_hdrp, (GET_HDR(next_hdrp) & ~(hdr_t)(PREV_ALLOC | PREV_MINI)) | prev_bits); 
 }
 
-/*Chooses which free list to use depending on size*/
-char **find_free_list(size_t asize)
+#ifdef THREAD_SAFE
+/*takes l, waiters spin on plain loads so they don't keep pulling the line away from the holder*/
+static void spin_lock(mm_lock_t *l)
 {
-	// listXmin <= asize < listXmax
-	//
-	//unsigned long long int sizes[14] = {0, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65636, 131072}; //strictly pow 2
-	//unsigned long long int sizes[14] = {0, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224}; //strictly +16
-	//unsigned long long int sizes[14] = {0, 32, 48, 64, 80, 96, 128, 256, 512, 1024, 2048, 4096, 8192, 16384}; //5 +16 last rest pow2
-	unsigned long long int sizes[14] = {0, 32, 48, 64, 80, 96, 112, 128, 512, 2048, 8192, 32768, 131072, 524288};  //half +16 half pow4
-	//
-	// list 0 will take any size less than list0max
-	size_t list0min = sizes[0];
-	size_t list0max = sizes[1];
-
-	size_t list1min = sizes[1];
-	size_t list1max = sizes[2];
-
-	size_t list2min = sizes[2];
-	size_t list2max = sizes[3];
-	
-	size_t list3min = sizes[3];
-	size_t list3max = sizes[4]; 
-
-	size_t list4min = sizes[4];
-	size_t list4max = sizes[5];
-
-	size_t list5min = sizes[5];
-	size_t list5max = sizes[6];
-
-	size_t list6min = sizes[6];
-	size_t list6max = sizes[7];
+	size_t spins = 0; 
+	while(__atomic_exchange_n(&l->held, 1, __ATOMIC_ACQUIRE))
+	{
+		while(__atomic_load_n(&l->held, __ATOMIC_RELAXED))
+		{
+			if(++spins % SPIN_YIELD == 0)
+			{
+				sched_yield(); 
+			}
+#if defined(__x86_64__)
+			__builtin_ia32_pause(); 
+#endif
+		}
+	}
+}
+static bool spin_trylock(mm_lock_t *l)
+{
+	return !__atomic_load_n(&l->held, __ATOMIC_RELAXED) && !__atomic_exchange_n(&l->held, 1, __ATOMIC_ACQUIRE); 
+}
+static void spin_unlock(mm_lock_t *l)
+{
+	__atomic_store_n(&l->held, 0, __ATOMIC_RELEASE); 
+}
+#endif
 
-	size_t list7min = sizes[7];
-	size_t list7max = sizes[8];
+/*Take and drop the lock of a slab class of an arena, and the heap lock*/
+static void lock_class(arena_t *arena, size_t class)
+{
+#ifdef THREAD_SAFE
+	spin_lock(&arena->slab_locks[class]); 
+#endif
+}
+static void unlock_class(arena_t *arena, size_t class)
+{
+#ifdef THREAD_SAFE
+	spin_unlock(&arena->slab_locks[class]); 
+#endif
+}
 
-	size_t list8min = sizes[8];
-	size_t list8max = sizes[9];
+/*the arena this thread allocates class from with that class locked, binding the thread on its first call*/
+static arena_t *lock_own_arena(size_t class)
+{
+#ifdef THREAD_SAFE
+	if(thread_arena == 0)
+	{
+		thread_arena = __atomic_fetch_add(&meta->next_arena, 1, __ATOMIC_RELAXED) % NUM_ARENAS + 1; 
+	}
+	arena_t *arena = &meta->arenas[thread_arena - 1]; 
+	if(!spin_trylock(&arena->slab_locks[class]))
+	{
+		/*someone else is on this arena, move on instead of queueing behind them*/
+		thread_arena = thread_arena % NUM_ARENAS + 1; 
+		arena = &meta->arenas[thread_arena - 1]; 
+		spin_lock(&arena->slab_locks[class]); 
+	}
+	return arena; 
+#else
+	return &meta->arenas[0]; 
+#endif
+}
+static void lock_heap(void)
+{
+#ifdef THREAD_SAFE
+	spin_lock(&meta->heap_lock); 
+#endif
+}
+static void unlock_heap(void)
+{
+#ifdef THREAD_SAFE
+	spin_unlock(&meta->heap_lock); 
+#endif
+}
 
-	size_t list9min = sizes[9];
-	size_t list9max = sizes[10];
+/*memlib calls, under sbrk_lock since mapped blks get to memlib without heap_lock*/
+static void *heap_sbrk(intptr_t incr)
+{
+#ifdef THREAD_SAFE
+	spin_lock(&meta->sbrk_lock); 
+	void *old_brk = mm_sbrk(incr); 
+	spin_unlock(&meta->sbrk_lock); 
+	return old_brk; 
+#else
+	return mm_sbrk(incr); 
+#endif
+}
+static void *map_region(size_t len)
+{
+#ifdef THREAD_SAFE
+	spin_lock(&meta->sbrk_lock); 
+	void *region = mm_mmap(len); 
+	spin_unlock(&meta->sbrk_lock); 
+	return region; 
+#else
+	return mm_mmap(len); 
+#endif
+}
+static void unmap_region(void *region, size_t len)
+{
+#ifdef THREAD_SAFE
+	spin_lock(&meta->sbrk_lock); 
+	mm_munmap(region, len); 
+	spin_unlock(&meta->sbrk_lock); 
+#else
+	mm_munmap(region, len); 
+#endif
+}
 
-	size_t list10min =sizes[10];
-	size_t list10max =sizes[11];
+/*Rounds up to the nearest multiple of ALIGNMENT*/
+static size_t align(size_t x)
+{
+    return ALIGNMENT * ((x+ALIGNMENT-1)/ALIGNMENT);
+}
 
-	size_t list11min = sizes[11];
-	size_t list11max = sizes[12];
+/*Adjust a request size to a block size, allocated blocks only carry a header*/
+static size_t adjust_size(size_t size)
+{
+	if (size <= MIN_BLK_SIZE - HSIZE)
+	{
+		return MIN_BLK_SIZE; 
+	}
+	if (size <= DSIZE + HSIZE)
+	{
+		return 2*DSIZE; 
+	}
+	return align(size + HSIZE); 
+}
 
-	size_t list12min = sizes[12];
-	size_t list12max = sizes[13];
+/*Returns floor(log2(x)), x must be non zero*/
+static size_t log2_floor(size_t x)
+{
+	return (sizeof(unsigned long)*8 - 1) - __builtin_clzl(x); 
+}
 
-	//list 13 takes all larger than list12max
+/*Maps a block size to the index of its free list using only a shift and a clz, no table walk*/
+static size_t size_class(size_t asize)
+{
+	size_t class; 
+	if(asize < LINEAR_CLASS_LIMIT)
+	{
+		class = asize/ALIGNMENT; 
+		return class > 1 ? class - 1 : 0; 
+	}
+	class = NUM_LINEAR_CLASSES + (log2_floor(asize) - log2_floor(LINEAR_CLASS_LIMIT))/CLASS_LOG_STEP; 
+	return class < NUM_FREELISTS ? class : NUM_FREELISTS - 1; 
+}
 
+/*Chooses which free list to use depending on size*/
+char **find_free_list(size_t asize)
+{
 	if(asize == 0)
 	{
 		return NULL; 
 	}
-	else if(list0min <= asize && asize < list0max)
-	{
-		curr_freelist = &freeblk_listp;
-	}
-	else if(list1min <= asize && asize < list1max)
+	return &meta->freeblk_lists[size_class(asize)]; 
+}
+
+/*Sets or clears the bit of list class in the nonempty bitmap*/
+static void mark_list_nonempty(size_t class)
+{
+	meta->nonempty_lists |= ((uint64_t)1 << class); 
+}
+static void mark_list_empty(size_t class)
+{
+	meta->nonempty_lists &= ~((uint64_t)1 << class); 
+}
+
+/*
+ * Cursor over one segregated list, the class is fixed when the walk starts so a hop is one load of the next link
+ * the blk after the current one is already loaded and prefetched while the caller tests the current one
+ */
+typedef struct
+{
+	size_t class; 		//List being walked
+	char *bp; 			//Current free blk, null once past the tail
+	char *next; 		//Free blk after bp, null at the tail
+} freelist_iter_t;
+
+/*makes bp the current blk of it and starts pulling in the blk after it, returns bp*/
+static inline char *freelist_step(freelist_iter_t *it, char *bp)
+{
+	it->bp = bp; 
+	it->next = NULL; 
+	if(bp != NULL)
 	{
-		curr_freelist = &freeblk_listp1;
+		it->next = GET_NEXT_FREEBLK(bp); 
 	}
-	else if(list2min <= asize && asize < list2max)
+	if(it->next != NULL)
 	{
-		curr_freelist = &freeblk_listp2;
+		__builtin_prefetch(HDRP(it->next)); 
 	}
-	else if(list3min <= asize && asize < list3max)
+	return bp; 
+}
+
+/*returns the head of list class, null if it is empty*/
+static inline char *freelist_begin(freelist_iter_t *it, size_t class)
+{
+	it->class = class; 
+	return freelist_step(it, meta->freeblk_lists[class]); 
+}
+
+/*returns the free blk after the current one, null past the tail*/
+static inline char *freelist_next(freelist_iter_t *it)
+{
+	dbg_assert(it->next == NULL || size_class(GET_SIZE(HDRP(it->next))) == it->class); 
+	return freelist_step(it, it->next); 
+}
+
+/*
+ * Side table scans, mm_init picks the widest one the CPU supports and the rest are the fallbacks
+ * the vector ones compare 4 or 2 sizes a step with signed 64 bit compares, sizes never get near 1<<63 so that is safe
+ */
+static size_t side_scan_scalar(const uint64_t *sizes, size_t n, uint64_t asize)
+{
+	for(size_t i = 0; i < n; i++)
 	{
-		curr_freelist = &freeblk_listp3;
+		if(asize <= sizes[i])
+		{
+			return i; 
+		}
 	}
-	else if(list4min <= asize && asize < list4max)
+	return n; 
+}
+
+#if defined(__x86_64__)
+/*two vectors a step, sizes[i] > asize - 1 is sizes[i] >= asize and also holds for asize 0*/
+__attribute__((target("avx2")))
+static size_t side_scan_avx2(const uint64_t *sizes, size_t n, uint64_t asize)
+{
+	__m256i need = _mm256_set1_epi64x((long long)(asize - 1)); 
+	size_t i = 0; 
+	for(; i + 8 <= n; i += 8)
 	{
-		curr_freelist = &freeblk_listp4;
+		__m256i lo = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(sizes + i)), need); 
+		__m256i hi = _mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(sizes + i + 4)), need); 
+		int mask = _mm256_movemask_pd(_mm256_castsi256_pd(lo)) | (_mm256_movemask_pd(_mm256_castsi256_pd(hi)) << 4); 
+		if(mask)
+		{
+			return i + __builtin_ctz(mask); 
+		}
 	}
-	else if(list5min <= asize && asize < list5max)
+	return i + side_scan_scalar(sizes + i, n - i, asize); 
+}
+
+__attribute__((target("sse4.2")))
+static size_t side_scan_sse42(const uint64_t *sizes, size_t n, uint64_t asize)
+{
+	__m128i need = _mm_set1_epi64x((long long)(asize - 1)); 
+	size_t i = 0; 
+	for(; i + 4 <= n; i += 4)
 	{
-		curr_freelist = &freeblk_listp5;
+		__m128i lo = _mm_cmpgt_epi64(_mm_loadu_si128((const __m128i *)(sizes + i)), need); 
+		__m128i hi = _mm_cmpgt_epi64(_mm_loadu_si128((const __m128i *)(sizes + i + 2)), need); 
+		int mask = _mm_movemask_pd(_mm_castsi128_pd(lo)) | (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2); 
+		if(mask)
+		{
+			return i + __builtin_ctz(mask); 
+		}
 	}
-	else if(list6min <= asize && asize < list6max)
+	return i + side_scan_scalar(sizes + i, n - i, asize); 
+}
+#endif
+
+/*returns the widest side table scan this CPU runs*/
+static side_scan_fn pick_side_scan(void)
+{
+#if defined(__x86_64__)
+	__builtin_cpu_init(); 
+	if(__builtin_cpu_supports("avx2"))
 	{
-		curr_freelist = &freeblk_listp6;
+		return side_scan_avx2; 
 	}
-	else if(list7min <= asize && asize < list7max)
+	if(__builtin_cpu_supports("sse4.2"))
 	{
-		curr_freelist = &freeblk_listp7;
+		return side_scan_sse42; 
 	}
-	else if(list8min <= asize && asize < list8max)
+#endif
+	return side_scan_scalar; 
+}
+
+/*Side tables of the mixed size classes below the tree*/
+static bool in_side_class(size_t class)
+{
+	return class >= NUM_LINEAR_CLASSES && class < TREE_CLASS; 
+}
+static side_table_t *side_table(size_t class)
+{
+	return &meta->side_tables[class - NUM_LINEAR_CLASSES]; 
+}
+
+/*maps a table twice the size of t, or SIDE_TABLE_MIN entries for a new one, and moves the entries over*/
+static bool side_grow(side_table_t *t)
+{
+	size_t cap = t->cap ? 2*t->cap : SIDE_TABLE_MIN; 
+	char *region = map_region(cap*(sizeof(uint64_t) + sizeof(char *))); 
+	if(region == (void *)-1)
 	{
-		curr_freelist = &freeblk_listp8;
+		return false; 
 	}
-	else if(list9min <= asize && asize < list9max)
+	uint64_t *sizes = (uint64_t *)region; 
+	char **addrs = (char **)(region + cap*sizeof(uint64_t)); 
+	if(t->cap)
 	{
-		curr_freelist = &freeblk_listp9;
+		memcpy(sizes, t->sizes, t->count*sizeof(uint64_t)); 
+		memcpy(addrs, t->addrs, t->count*sizeof(char *)); 
+		unmap_region(t->sizes, t->cap*(sizeof(uint64_t) + sizeof(char *))); 
 	}
-	else if(list10min <= asize && asize < list10max)
+	t->sizes = sizes; 
+	t->addrs = addrs; 
+	t->cap = cap; 
+	return true; 
+}
+
+/*appends free blk bp to the table of its class, false if the table is full and can't grow*/
+static bool side_insert(char *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp)); 
+	size_t class = size_class(size); 
+	side_table_t *t = side_table(class); 
+	if(t->count == t->cap && !side_grow(t))
 	{
-		curr_freelist = &freeblk_listp10;
+		return false; 
 	}
-	else if(list11min <= asize && asize < list11max)
+	if(t->count == 0)
 	{
-		curr_freelist = &freeblk_listp11;
+		mark_list_nonempty(class); 
 	}
-	else if(list12min <= asize && asize < list12max)
+	t->sizes[t->count] = size; 
+	t->addrs[t->count] = bp; 
+	PUT(bp, t->count); 
+	t->count ++; 
+	return true; 
+}
+
+/*takes bp out of its table by moving the last entry into its slot*/
+static bool side_remove(char *bp)
+{
+	size_t class = size_class(GET_SIZE(HDRP(bp))); 
+	side_table_t *t = side_table(class); 
+	size_t i = GET(bp); 
+	if(i >= t->count || t->addrs[i] != bp)
 	{
-		curr_freelist = &freeblk_listp12;
+		return false; 
 	}
-	else
+	t->count --; 
+	t->sizes[i] = t->sizes[t->count]; 
+	t->addrs[i] = t->addrs[t->count]; 
+	PUT(t->addrs[i], i); 
+	if(t->count == 0)
 	{
-		curr_freelist = &freeblk_listp13;
+		mark_list_empty(class); 
 	}
-
-
-	return curr_freelist;
+	return true; 
 }
 
-/*search through all blocks in heap looking for a free block of adequate size, returns NULL if no fit*/
-/*NOT IN USE*/
-void *find_fit(size_t asize)
+/*
+ * returns a blk of list class with at least asize bytes, null if there is none
+ * the first fitting entry, or with address ordered first fit the lowest fitting address
+ */
+static char *side_find_fit(size_t class, size_t asize)
 {
-	void *bp; 
-
-	/*
-	if(asize > CHUNKSIZE)
-	{
-		return NULL; 
-	}
-	*/
-	
-	for (bp = heap_listp + DSIZE; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	side_table_t *t = side_table(class); 
+	size_t i = meta->side_scan(t->sizes, t->count, asize); 
+#ifdef PLACEMENT_AOFF
+	char *fit = NULL; 
+	while(i < t->count)
 	{
-		//mm_checkheap(7);
-		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
+		if(fit == NULL || t->addrs[i] < fit)
 		{
-			return bp; 
+			fit = t->addrs[i]; 
 		}
+		i += 1 + meta->side_scan(t->sizes + i + 1, t->count - i - 1, asize); 
 	}
-	return NULL; 
+	return fit; 
+#else
+	return i < t->count ? t->addrs[i] : NULL; 
+#endif
 }
 
-/*checks to see if two free blocks are in the same free list*/
-bool in_same_freelist(void *bp1, void*bp2)
+/*
+ * Exact fit index, a chained blk keeps its next and prev links EXACT_LINK_OFFSET into its payload
+ * a blk of an indexed size that didn't get a slot has its next link pointing at itself instead
+ */
+static bool in_exact_range(size_t size)
+{
+#ifdef PLACEMENT_AOFF
+	return false; 
+#else
+	return size >= EXACT_MIN_SIZE && size <= EXACT_MAX_SIZE; 
+#endif
+}
+static char **exact_links(char *bp)
 {
-	char **bp1_freelst = find_free_list(GET_SIZE(HDRP(bp1))); 
-	char **bp2_freelst = find_free_list(GET_SIZE(HDRP(bp2)));
-	return *bp1_freelst == *bp2_freelst;
+	return (char **)(bp + EXACT_LINK_OFFSET); 
 }
 
-/*loops through the appropriate freeblk list and returns the first free block of appropriate size, else null*/
-/*MAYBE: Use binary search for added throughput*/
-void *find_fit_given_free_list(size_t asize)
+/*home slot of size, a fibonacci hash of its ALIGNMENT steps*/
+static size_t exact_home(size_t size)
 {
-	curr_freelist = find_free_list(asize);
+	return ((size/ALIGNMENT)*0x9e3779b97f4a7c15) >> (64 - EXACT_SLOTS_LOG); 
+}
 
-	if(*curr_freelist == heap_listp)
-	{
-		return NULL; 
-	}
-	/*
-	 * MAYBE: if i need more space util, make this a for loop and search all 
-	 * freelists with greater size than current block, this will take 
-	 * longer and decrease throughput a bit
-	 */
-	char *bp; 
-	for(bp = *curr_freelist; GET_NEXT_FREEBLK(bp) != 0; bp = GET_NEXT_FREEBLK(bp))
+/*returns the slot holding size, else the empty slot it would go in, else EXACT_SLOTS when its probe run is full*/
+static size_t exact_probe(size_t size)
+{
+	size_t i = exact_home(size); 
+	for(size_t n = 0; n < EXACT_PROBE_MAX && n < EXACT_SLOTS; n++, i = (i + 1) & (EXACT_SLOTS - 1))
 	{
-		if(asize<=GET_SIZE(HDRP(bp)))
+		if(meta->exact_sizes[i] == size || meta->exact_sizes[i] == 0)
 		{
-			return bp; 
+			return i; 
 		}
 	}
-	if(asize<=GET_SIZE(HDRP(bp)))
+	return EXACT_SLOTS; 
+}
+
+/*empties slot i, later sizes of its probe run shift back into the hole, which only brings them closer to their home*/
+static void exact_clear(size_t i)
+{
+	meta->exact_sizes[i] = 0; 
+	meta->exact_heads[i] = NULL; 
+	size_t j = i; 
+	while(true)
 	{
-		return bp; 
+		j = (j + 1) & (EXACT_SLOTS - 1); 
+		if(meta->exact_sizes[j] == 0)
+		{
+			break; 
+		}
+		size_t home = exact_home(meta->exact_sizes[j]); 
+		if(((i - home) & (EXACT_SLOTS - 1)) < ((j - home) & (EXACT_SLOTS - 1)))
+		{
+			meta->exact_sizes[i] = meta->exact_sizes[j]; 
+			meta->exact_heads[i] = meta->exact_heads[j]; 
+			meta->exact_sizes[j] = 0; 
+			meta->exact_heads[j] = NULL; 
+			i = j; 
+		}
 	}
-
-	return NULL; 
 }
 
-/*allocates the given free block for size asize*/
-void place(void *bp, size_t asize)
+/*returns a free blk of exactly asize bytes if one is indexed, else null*/
+static char *exact_find(size_t asize)
 {
-	size_t csize = GET_SIZE(HDRP(bp)); 
+	if(!in_exact_range(asize))
+	{
+		return NULL; 
+	}
+	size_t i = exact_probe(asize); 
+	return i < EXACT_SLOTS ? meta->exact_heads[i] : NULL; 
+}
 
-	/*if the block we are placing is smaller than the free block its going into,
-	  split it so that the free space is a new free block*/ 
-	PUT(HDRP(bp), PACK(GET_SIZE(HDRP(bp)), 1));
-	remove_freeblk(bp); 
-	if ((csize - asize) >= (2*DSIZE))
+/*pushes free blk bp on the chain of its size*/
+static void exact_insert(char *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp)); 
+	if(!in_exact_range(size))
 	{
-		PUT(HDRP(bp), PACK(asize, 1)); 
-		//TOREM: 
-		PUT(FTRP(bp), PACK(asize, 1)); 
-		char *newbp = NEXT_BLKP(bp); 
-		PUT(HDRP(newbp), PACK(csize-asize, 0)); 
-		PUT(FTRP(newbp), PACK(csize-asize, 0)); 
-		coalesce(newbp);
+		return; 
 	}
+	char **links = exact_links(bp); 
+	size_t i = exact_probe(size); 
+	if(i == EXACT_SLOTS)
+	{
+		links[0] = bp; 
+		return; 
+	}
+	meta->exact_sizes[i] = size; 
+	links[0] = meta->exact_heads[i]; 
+	links[1] = NULL; 
+	if(links[0] != NULL)
+	{
+		exact_links(links[0])[1] = bp; 
+	}
+	meta->exact_heads[i] = bp; 
+}
 
-	/*if its the perfect size, simply change the free block to allocated*/
-	else
+/*unlinks free blk bp from the chain of its size, its header must still hold the size it was indexed under*/
+static void exact_remove(char *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp)); 
+	char **links = exact_links(bp); 
+	if(!in_exact_range(size) || links[0] == bp)
+	{
+		return; 
+	}
+	if(links[0] != NULL)
+	{
+		exact_links(links[0])[1] = links[1]; 
+	}
+	if(links[1] != NULL)
+	{
+		exact_links(links[1])[0] = links[0]; 
+		return; 
+	}
+	size_t i = exact_probe(size); 
+	meta->exact_heads[i] = links[0]; 
+	if(links[0] == NULL)
 	{
-		PUT(HDRP(bp), PACK(csize, 1));
-		//TOREM:
-		PUT(FTRP(bp), PACK(csize, 1));
+		exact_clear(i); 
 	}
 }
 
-/*places a free block into the proper freeblk list*/
-bool place_freeblk(void *new_freeblk)
+/*
+ * Best fit tree of large free blocks
+ * Based on the splay tree in stree.c, but intrusive: a node is the free blk itself
+ * and the key is (size, address) so blocks of equal size are still distinct
+ */
+static bool in_tree_class(size_t size)
 {
-	
-	//dbg code
-//	clock_t start, end; 
-//	double CPUtime; 
-//	start = clock();
-	//end dbg
+	return size_class(size) >= TREE_CLASS; 
+}
 
-	curr_freelist = find_free_list(GET_SIZE(HDRP(new_freeblk)));
+/*Orders nodes by size then by address*/
+static bool tnode_less(tnode_t *a, tnode_t *b)
+{
+	size_t asize = GET_SIZE(HDRP(a)); 
+	size_t bsize = GET_SIZE(HDRP(b)); 
+	return asize < bsize || (asize == bsize && a < b); 
+}
 
-	//returns false if passed block is not free
-	if(GET_ALLOC(HDRP(new_freeblk)))
+static void tree_left_rotate(tnode_t *x)
+{
+	tnode_t *y = x->right;
+	if (y) 
 	{
-		return false; 
+		x->right = y->left;
+		if (y->left) y->left->parent = x;
+		y->parent = x->parent;
 	}
-	
+	if (!x->parent) meta->large_tree_root = y;
+	else if (x == x->parent->left) x->parent->left = y;
+	else x->parent->right = y;
+	if (y) y->left = x;
+	x->parent = y;
+}
 
-	//initialises list to first free blk if currenlty empty
-	if(*curr_freelist == heap_listp)
+static void tree_right_rotate(tnode_t *x)
+{
+	tnode_t *y = x->left;
+	if (y) 
 	{
-		*curr_freelist = new_freeblk; 
-		SET_NEXT_FREEBLK(*curr_freelist, 0x00000000);
-		SET_PREV_FREEBLK(*curr_freelist, 0x00000000);
-
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("PlaceFreBlk EMPTY took: %f s\n", CPUtime);
-		//end dbg
-
-		return true; 
+		x->left = y->right;
+		if (y->right) y->right->parent = x;
+		y->parent = x->parent;
 	}
+	if (!x->parent) meta->large_tree_root = y;
+	else if (x == x->parent->left) x->parent->left = y;
+	else x->parent->right = y;
+	if (y) y->right = x;
+	x->parent = y;
+}
 
-	//otherwise placed the new freeblk in its sorted position by increasing size
-	else
+static void tree_splay(tnode_t *x)
+{
+	while (x->parent) 
 	{
-		// nb cb next
-		char *comp_block = *curr_freelist; 
+		if (!x->parent->parent) 
 		{
-			*curr_freelist = new_freeblk; 
-			SET_PREV_FREEBLK(new_freeblk, (uint64_t)0x00000000); 
-			SET_NEXT_FREEBLK(new_freeblk, (uint64_t)comp_block); 
-			SET_PREV_FREEBLK(comp_block, (uint64_t)new_freeblk);
-
-			//dbg code
-		//	end = clock();
-		//	CPUtime = (double)((end - start));
-		//	dbg_printf("PlaceFreBlk FIRST took: %f s\n", CPUtime);
-			//end dbg
-
-			return true; 
-		}
-		// prev nb cb next
-		while(in_heap(GET_NEXT_FREEBLK(comp_block)))
+			if (x->parent->left == x) tree_right_rotate(x->parent);
+			else tree_left_rotate(x->parent);
+		} 
+		else if (x->parent->left == x && x->parent->parent->left == x->parent) 
 		{
-			if(GET_SIZE(HDRP(comp_block)) >=  GET_SIZE(HDRP(new_freeblk)))
-			{	
-				SET_NEXT_FREEBLK(new_freeblk, (uint64_t)comp_block); 
-				SET_PREV_FREEBLK(new_freeblk, (uint64_t)GET_PREV_FREEBLK(comp_block)); 	
-				SET_NEXT_FREEBLK(GET_PREV_FREEBLK(comp_block), (uint64_t)new_freeblk); 
-				SET_PREV_FREEBLK(comp_block, (uint64_t)new_freeblk); 
-
-				//dbg code
-			//	end = clock();
-			//	CPUtime = (double)((end - start));
-			//	dbg_printf("PlaceFreBlk MID took: %f s\n", CPUtime);
-				//end dbg
-
-				return true; 
-			}
-			comp_block = GET_NEXT_FREEBLK(comp_block); 
-		}
-		// prev nb cb 
-		if(GET_SIZE(HDRP(comp_block)) >= GET_SIZE(HDRP(new_freeblk)))
+			tree_right_rotate(x->parent->parent);
+			tree_right_rotate(x->parent);
+		} 
+		else if (x->parent->right == x && x->parent->parent->right == x->parent) 
 		{
-			SET_NEXT_FREEBLK(new_freeblk, (uint64_t)comp_block); 
-			SET_PREV_FREEBLK(new_freeblk, (uint64_t)GET_PREV_FREEBLK(comp_block)); 	
-			SET_NEXT_FREEBLK(GET_PREV_FREEBLK(comp_block), (uint64_t)new_freeblk); 
-			SET_PREV_FREEBLK(comp_block, (uint64_t)new_freeblk); 
-
-			//dbg code
-		//	end = clock();
-		//	CPUtime = (double)((end - start));
-		//	dbg_printf("PlaceFreBlk B4LAST took: %f s\n", CPUtime);
-			//end dbg
-
-			return true; 
-		}
-		// prev cb nb
-		else
+			tree_left_rotate(x->parent->parent);
+			tree_left_rotate(x->parent);
+		} 
+		else if (x->parent->left == x && x->parent->parent->right == x->parent) 
 		{
-			SET_NEXT_FREEBLK(comp_block, (uint64_t)new_freeblk);
-			SET_PREV_FREEBLK(new_freeblk, (uint64_t)comp_block); 
-			SET_NEXT_FREEBLK(new_freeblk, (uint64_t)0x00000000);
-
-			//dbg code
-		//	end = clock();
-		//	CPUtime = (double)((end - start));
-		//	dbg_printf("PlaceFreBlk LAST took: %f s\n", CPUtime);
-			//end dbg
-
-			return true; 
-		}
-
-		/*
-		//otherwise sets the next free blk of the last free blk to the new freeblk
-		char *bp = *curr_freelist; 
-		while(GET_NEXT_FREEBLK(bp) != 0)
+			tree_right_rotate(x->parent);
+			tree_left_rotate(x->parent);
+		} 
+		else 
 		{
-			bp = GET_NEXT_FREEBLK(bp); 
+			tree_left_rotate(x->parent);
+			tree_right_rotate(x->parent);
 		}
-		SET_NEXT_FREEBLK(bp, (uint64_t)new_freeblk); 
-		SET_PREV_FREEBLK(new_freeblk, (uint64_t)bp); 
-		SET_NEXT_FREEBLK(new_freeblk, 0); 
-
-		return true; 
-		*/
 	}
-	return false; 
-} 
-
+}
 
-/*remove a free block from the freeblk list*/ 
-bool remove_freeblk(void *block_to_remove)
+static void tree_replace(tnode_t *u, tnode_t *v)
 {
-	
-	//dbg code
-//	clock_t start, end; 
-//	double CPUtime; 
-//	start = clock();
-	//end dbg
+	if (!u->parent) meta->large_tree_root = v;
+	else if (u == u->parent->left) u->parent->left = v;
+	else u->parent->right = v;
+	if (v) v->parent = u->parent;
+}
 
-	curr_freelist = find_free_list(GET_SIZE(HDRP(block_to_remove)));
+/*inserts a large free blk into the tree*/
+static bool tree_insert_freeblk(void *bp)
+{
+	tnode_t *z = (tnode_t *)bp; 
+	tnode_t *x = meta->large_tree_root; 
+	tnode_t *p = NULL; 
+	while (x)
+	{
+		p = x; 
+		x = tnode_less(z, x) ? x->left : x->right; 
+	}
+	z->parent = p; 
+	z->left = z->right = NULL; 
+	if (!p) meta->large_tree_root = z; 
+	else if (tnode_less(z, p)) p->left = z; 
+	else p->right = z; 
+	tree_splay(z); 
+	mark_list_nonempty(TREE_CLASS); 
+	return true; 
+}
 
-	//returns false if freelist is uninitialised
-	if(*curr_freelist == heap_listp)    
+/*removes a large free blk from the tree, the blk is the node so no search is needed*/
+static bool tree_remove_freeblk(void *bp)
+{
+	tnode_t *z = (tnode_t *)bp; 
+	tree_splay(z); 
+	if (!z->left) tree_replace(z, z->right);
+	else if (!z->right) tree_replace(z, z->left);
+	else 
 	{
-		return false;
+		tnode_t *y = z->right; 
+		while (y->left) y = y->left; 
+		if (y->parent != z) 
+		{
+			tree_replace(y, y->right);
+			y->right = z->right;
+			y->right->parent = y;
+		}
+		tree_replace(z, y);
+		y->left = z->left;
+		y->left->parent = y;
 	}
-	//returns false if block is currently free
-	if(!GET_ALLOC(HDRP(block_to_remove)))
+	if (!meta->large_tree_root)
 	{
-		return false; 
+		mark_list_empty(TREE_CLASS); 
 	}
-	if(block_to_remove == *curr_freelist)
+	return true; 
+}
+
+/*returns the smallest large free blk of at least asize bytes, ties go to the lowest address, else null*/
+static void *find_fit_in_tree(size_t asize)
+{
+	tnode_t *x = meta->large_tree_root; 
+	tnode_t *fit = NULL; 
+	while (x)
 	{
-		//if we are removing the first and only block of the list, set the list back to uninitialised
-		if(GET_NEXT_FREEBLK(*curr_freelist) == 0)
+		if (asize <= GET_SIZE(HDRP(x)))
 		{
-			*curr_freelist = heap_listp; 
+			fit = x; 
+			x = x->left; 
 		}
-		//if we are removing the first block of the list and there are still blocks left, 
-		//set the head of the list to the second element in the list
 		else
 		{
-			SET_PREV_FREEBLK(GET_NEXT_FREEBLK(*curr_freelist), 0); 
-			*curr_freelist = GET_NEXT_FREEBLK(*curr_freelist); 	
-
+			x = x->right; 
 		}
-
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("RemFreBlk FIRST took: %f s\n", CPUtime);
-		//end dbg
-
-		return true; 
 	}
-	//loop through the rest of the freelist and extract the block to remove if found
-	void *bp; 
-	for(bp = *curr_freelist; GET_NEXT_FREEBLK(bp) != 0; bp = GET_NEXT_FREEBLK(bp))
+	if (fit)
 	{
-		if(bp == block_to_remove)
-		{
-			SET_NEXT_FREEBLK(GET_PREV_FREEBLK(bp), (uint64_t)GET_NEXT_FREEBLK(bp)); 
-			
-			SET_PREV_FREEBLK(GET_NEXT_FREEBLK(bp), (uint64_t)GET_PREV_FREEBLK(bp)); 
-
-			//dbg code
-		//	end = clock();
-		//	CPUtime = (double)((end - start));
-		//	dbg_printf("RemFreBlk MID took: %f s\n", CPUtime);
-			//end dbg		
-
-			return true; 
-		}
+		tree_splay(fit); 
 	}
-	//this is an extra iteration incase the block to remove is the last block in the list
-	if(bp == block_to_remove)
-	{
-		SET_NEXT_FREEBLK(GET_PREV_FREEBLK(bp), 0); 
-
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("RemFreBlk LAST took: %f s\n", CPUtime);
-		//end dbg	
+	return fit; 
+}
 
-		return true; 
+#ifdef PLACEMENT_TLSF
+/*
+ * TLSF placement engine
+ * first level is the power of two of the size, second level splits it in TLSF_SL_COUNT linear steps,
+ * lists are doubly linked through the same two link words as the segregated lists but use NULL for empty
+ */
+static void tlsf_mapping(size_t size, size_t *fl, size_t *sl)
+{
+	if(size < ((size_t)1 << TLSF_FL_SHIFT))
+	{
+		*fl = 0; 
+		*sl = size >> ALIGNMENT_LOG; 
+		return; 
 	}
-	
-	return false; 
+	size_t log2 = log2_floor(size); 
+	*fl = log2 - TLSF_FL_SHIFT + 1; 
+	*sl = (size >> (log2 - TLSF_SL_LOG)) - TLSF_SL_COUNT; 
 }
 
-/*combines adjacent free blocks then places it in the appropriate free list*/
-void *coalesce(void *bp)
+/*Rounds a request up to the next list boundary so every blk of the list it maps to fits it*/
+static size_t tlsf_round_up(size_t asize)
 {
-	//dbg code
-//	clock_t start, end; 
-//	double CPUtime; 
-//	start = clock();
-	//end dbg
-
-	size_t prev_alloc = GET_ALLOC(HDRP(PREV_BLKP(bp)));
-	size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-	size_t size = GET_SIZE(HDRP(bp)); 
-
-	/*Case 1: Neither blocks free*/
-	if((prev_alloc && next_alloc))
+	if(asize < ((size_t)1 << TLSF_FL_SHIFT))
 	{
-		place_freeblk(bp); 
-
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("Coalesce NONE took: %f s\n", CPUtime);
-		//end dbg
-	
-		return bp;  
+		return asize; 
 	}
+	return asize + ((size_t)1 << (log2_floor(asize) - TLSF_SL_LOG)) - 1; 
+}
 
-	/*Case 2: Only next block free*/ 
-	else if(prev_alloc && !next_alloc)
+/*pushes a free blk on the head of its TLSF list*/
+static bool tlsf_insert_freeblk(void *bp)
+{
+	size_t fl, sl; 
+	tlsf_mapping(GET_SIZE(HDRP(bp)), &fl, &sl); 
+	char *head = meta->tlsf_lists[fl][sl]; 
+	SET_NEXT_FREEBLK(bp, (uint64_t)head); 
+	SET_PREV_FREEBLK(bp, 0x00000000); 
+	if(head != NULL)
 	{
-		char *blk_to_remove = NEXT_BLKP(bp);
-
-		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
-		
-		PUT(HDRP(blk_to_remove), PACK(GET_SIZE(HDRP(blk_to_remove)), 1)); 
-		remove_freeblk(blk_to_remove); 
-
-		PUT(HDRP(bp), PACK(size, 0)); 
-		PUT(FTRP(bp), PACK(size, 0)); 
-
-
-		place_freeblk(bp); 
-
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("Coalesce NEXT took: %f s\n", CPUtime);
-		//end dbg
-		
-		return bp; 
+		SET_PREV_FREEBLK(head, (uint64_t)bp); 
 	}
+	meta->tlsf_lists[fl][sl] = bp; 
+	meta->tlsf_sl_bitmap[fl] |= (uint32_t)1 << sl; 
+	meta->tlsf_fl_bitmap |= (uint64_t)1 << fl; 
+	return true; 
+}
 
-	/*Case 3: Only prev block free*/
-	else if(!prev_alloc && next_alloc)
-	{	
-		size += GET_SIZE(HDRP(PREV_BLKP(bp)));
-		if(find_free_list(GET_SIZE(HDRP(PREV_BLKP(bp)))) == find_free_list(size))
-		{
-			PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			PUT(FTRP(PREV_BLKP(bp)), PACK(size, 0));
-			bp = PREV_BLKP(bp);
-		}
-		else
+/*unlinks a free blk from its TLSF list through its own links, no walk*/
+static bool tlsf_remove_freeblk(void *bp)
+{
+	size_t fl, sl; 
+	tlsf_mapping(GET_SIZE(HDRP(bp)), &fl, &sl); 
+	char *next = GET_NEXT_FREEBLK(bp); 
+	char *prev = GET_PREV_FREEBLK(bp); 
+	if(next != NULL)
+	{
+		SET_PREV_FREEBLK(next, (uint64_t)prev); 
+	}
+	if(prev != NULL)
+	{
+		SET_NEXT_FREEBLK(prev, (uint64_t)next); 
+	}
+	else
+	{
+		meta->tlsf_lists[fl][sl] = next; 
+		if(next == NULL)
 		{
-			PUT(HDRP(PREV_BLKP(bp)), PACK(GET_SIZE(HDRP(PREV_BLKP(bp))), 1)); 
-			remove_freeblk(PREV_BLKP(bp));
-			PUT(HDRP(PREV_BLKP(bp)), PACK(GET_SIZE(HDRP(PREV_BLKP(bp))), 0)); 
-			PUT(FTRP(bp), PACK(size, 0));
-			PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			bp = PREV_BLKP(bp);
-			place_freeblk(bp);
+			meta->tlsf_sl_bitmap[fl] &= ~((uint32_t)1 << sl); 
+			if(meta->tlsf_sl_bitmap[fl] == 0)
+			{
+				meta->tlsf_fl_bitmap &= ~((uint64_t)1 << fl); 
+			}
 		}
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("Coalesce PREV took: %f s\n", CPUtime);
-		//end dbg
 	}
+	return true; 
+}
 
-	/*Case 4: Both prev and next free*/
-	else if(!prev_alloc && !next_alloc)
+/*returns the head of the first nonempty list whose blks all fit asize, else null*/
+static void *tlsf_find_fit(size_t asize)
+{
+	size_t fl, sl; 
+	tlsf_mapping(tlsf_round_up(asize), &fl, &sl); 
+	if(fl >= TLSF_FL_COUNT)
 	{
-		PUT(HDRP(NEXT_BLKP(bp)), PACK(GET_SIZE(HDRP(NEXT_BLKP(bp))), 1)); 
-		remove_freeblk(NEXT_BLKP(bp));
-
-		size += (GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(HDRP(NEXT_BLKP(bp)))); 
-		if(find_free_list(GET_SIZE(HDRP(bp))) == find_free_list(size))
-		{
-			PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			PUT(FTRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			bp = PREV_BLKP(bp); 
-	
-			//SET_NEXT_FREEBLK(bp, (uint64_t)GET_NEXT_FREEBLK(GET_NEXT_FREEBLK(bp)));
-			//SET_PREV_FREEBLK(GET_NEXT_FREEBLK(bp), (uint64_t)bp);
-		}
-		else 
+		return NULL; 
+	}
+	uint32_t sl_map = meta->tlsf_sl_bitmap[fl] & (~(uint32_t)0 << sl); 
+	if(sl_map == 0)
+	{
+		uint64_t fl_map = meta->tlsf_fl_bitmap & (~(uint64_t)0 << (fl + 1)); 
+		if(fl_map == 0)
 		{
-			PUT(HDRP(PREV_BLKP(bp)), PACK(GET_SIZE(HDRP(PREV_BLKP(bp))), 1)); 
-			remove_freeblk(PREV_BLKP(bp));
-			PUT(HDRP(PREV_BLKP(bp)), PACK(GET_SIZE(HDRP(PREV_BLKP(bp))), 0)); 
-			
-			PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			PUT(FTRP(PREV_BLKP(bp)), PACK(size, 0)); 
-			bp = PREV_BLKP(bp); 
-	
-			//SET_NEXT_FREEBLK(bp, (uint64_t)GET_NEXT_FREEBLK(GET_NEXT_FREEBLK(bp)));
-			//SET_PREV_FREEBLK(GET_NEXT_FREEBLK(bp), (uint64_t)bp);
-			place_freeblk(bp);
+			return NULL; 
 		}
-		
-		//dbg code
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("Coalesce PREV&NEXT took: %f s\n", CPUtime);
-		//end dbg
+		fl = __builtin_ctzl(fl_map); 
+		sl_map = meta->tlsf_sl_bitmap[fl]; 
 	}
+	sl = __builtin_ctz(sl_map); 
+	return meta->tlsf_lists[fl][sl]; 
+}
+#endif // PLACEMENT_TLSF
 
-	else
+/*Returns true if a free blk growing from old_size to new_size can stay where it is in the free lists*/
+static bool stays_in_freelist(size_t old_size, size_t new_size)
+{
+#ifdef PLACEMENT_TLSF
+	size_t old_fl, old_sl, new_fl, new_sl; 
+	tlsf_mapping(old_size, &old_fl, &old_sl); 
+	tlsf_mapping(new_size, &new_fl, &new_sl); 
+	return old_fl == new_fl && old_sl == new_sl; 
+#else
+	return size_class(old_size) == size_class(new_size) && !in_tree_class(new_size); 
+#endif
+}
+
+/*rewrites the size of free blk bp where stays_in_freelist() let it stay, a side table entry keeps its copy in step*/
+static void resize_listed_freeblk(char *bp, size_t size)
+{
+	exact_remove(bp); 
+	PUT_BLK(bp, size, 0); 
+	exact_insert(bp); 
+#ifndef PLACEMENT_TLSF
+	if(in_side_class(size_class(size)))
 	{
-		return NULL; 
+		side_table(size_class(size))->sizes[GET(bp)] = size; 
 	}
-	return bp; 
+#endif
 }
 
-/*extends heap by n bytes*/ 
-void *extend_heap(size_t bytes)
+/*
+ * Returns the head of the first nonempty list above class, else null
+ * every blk in a larger list is at least as big as the smallest size of that list
+ * so any of them fits whatever mapped to class, the head is taken without walking
+ */
+static void *find_fit_in_larger_list(size_t class)
 {
-	char *bp; 
-	size_t size = bytes; 
+	uint64_t larger = meta->nonempty_lists & ~(((uint64_t)2 << class) - 1); 
+	if(larger == 0)
+	{
+		return NULL; 
+	}
+	size_t fit_class = __builtin_ctzl(larger); 
+	if(fit_class >= TREE_CLASS)
+	{
+		return find_fit_in_tree(0); 
+	}
+	if(in_side_class(fit_class))
+	{
+		return side_find_fit(fit_class, 0); 
+	}
+	return meta->freeblk_lists[fit_class]; 
+}
+
+/*search through all blocks in heap looking for a free block of adequate size, returns NULL if no fit*/
+/*NOT IN USE*/
+void *find_fit(size_t asize)
+{
+	void *bp; 
+
+	/*
+	if(asize > CHUNKSIZE)
+	{
+		return NULL; 
+	}
+	*/
+	
+	for (bp = heap_listp + DSIZE; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	{
+		//mm_checkheap(7);
+		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
+		{
+			return bp; 
+		}
+	}
+	return NULL; 
+}
+
+/*checks to see if two free blocks are in the same free list*/
+bool in_same_freelist(void *bp1, void*bp2)
+{
+	return size_class(GET_SIZE(HDRP(bp1))) == size_class(GET_SIZE(HDRP(bp2)));
+}
+
+/*
+ * loops through the appropriate freeblk list and returns the first free block of appropriate size,
+ * on a miss falls back to the next larger nonempty list, else null
+ */
+/*MAYBE: Use binary search for added throughput*/
+void *find_fit_given_free_list(size_t asize)
+{
+	char *exact = exact_find(asize); 
+	if(exact != NULL)
+	{
+		return exact; 
+	}
+#ifdef PLACEMENT_TLSF
+	return tlsf_find_fit(asize); 
+#else
+	size_t class = size_class(asize); 
+	if(class >= TREE_CLASS)
+	{
+		return find_fit_in_tree(asize); 
+	}
+	if(in_side_class(class))
+	{
+		char *bp = side_find_fit(class, asize); 
+		return bp != NULL ? bp : find_fit_in_larger_list(class); 
+	}
+	freelist_iter_t it; 
+	for(char *bp = freelist_begin(&it, class); bp != NULL; bp = freelist_next(&it))
+	{
+		if(asize<=GET_SIZE(HDRP(bp)))
+		{
+			return bp; 
+		}
+	}
+
+	return find_fit_in_larger_list(class); 
+#endif
+}
+
+/*allocates the given block for size asize, bp is either a free block or the allocated block being shrunk by realloc*/
+void place(void *bp, size_t asize)
+{
+	size_t csize = GET_SIZE(HDRP(bp)); 
+
+	if(!GET_ALLOC(HDRP(bp)))
+	{
+		remove_freeblk(bp); 
+	}
+
+	/*if the block we are placing is smaller than the free block its going into,
+	  split it so that the free space is a new free block*/ 
+	if ((csize - asize) >= MIN_BLK_SIZE)
+	{
+		PUT_BLK(bp, asize, 1); 
+		char *newbp = NEXT_BLKP(bp); 
+		PUT_BLK(newbp, csize-asize, 0); 
+		coalesce(newbp);
+	}
+
+	/*if its the perfect size, simply change the free block to allocated*/
+	else
+	{
+		PUT_BLK(bp, csize, 1); 
+	}
+}
+
+/*
+ * allocates asize bytes of the free blk bp found by a fit search, returns the allocated blk
+ * which end it is carved from depends on asize, see SPLIT_THRESHOLD
+ */
+static char *place_fit(char *bp, size_t asize)
+{
+	size_t csize = GET_SIZE(HDRP(bp)); 
+	bool high = (asize <= SPLIT_THRESHOLD) == SPLIT_SMALL_HIGH; 
+	if(!high || csize - asize < MIN_BLK_SIZE)
+	{
+		place(bp, asize); 
+		return bp; 
+	}
+
+	/*the low part stays free, it can't touch another free blk since bp didn't*/
+	remove_freeblk(bp); 
+	PUT_BLK(bp, csize - asize, 0); 
+	char *allocbp = NEXT_BLKP(bp); 
+	PUT_BLK(allocbp, asize, 1); 
+	place_freeblk(bp); 
+	return allocbp; 
+}
+
+/*pushes a free mini block on list 0, it has no prev link so only the next link is written*/
+static bool place_miniblk(void *new_freeblk)
+{
+	size_t class = size_class(MINI_BLK_SIZE); 
+	char **list = &meta->freeblk_lists[class]; 
+	if(*list == NULL)
+	{
+		mark_list_nonempty(class); 
+	}
+	SET_NEXT_FREEBLK(new_freeblk, (uint64_t)*list); 
+	*list = new_freeblk; 
+	return true; 
+}
+
+/*unlinks a mini block from list 0 by walking to its predecessor*/
+static bool remove_miniblk(void *block_to_remove)
+{
+	size_t class = size_class(MINI_BLK_SIZE); 
+	char **list = &meta->freeblk_lists[class]; 
+	char *prev_bp = NULL; 
+	freelist_iter_t it; 
+	for(char *bp = freelist_begin(&it, class); bp != NULL; bp = freelist_next(&it))
+	{
+		if(bp == block_to_remove)
+		{
+			if(prev_bp == NULL)
+			{
+				*list = it.next; 
+			}
+			else
+			{
+				SET_NEXT_FREEBLK(prev_bp, (uint64_t)it.next); 
+			}
+			if(*list == NULL)
+			{
+				mark_list_empty(class); 
+			}
+			return true; 
+		}
+		prev_bp = bp; 
+	}
+	return false; 
+}
+
+/*places a free block into the proper freeblk list, the top blk becomes the wilderness instead*/
+bool place_freeblk(void *new_freeblk)
+{
+	if(GET_SIZE(HDRP(NEXT_BLKP(new_freeblk))) == 0)
+	{
+		meta->wilderness = new_freeblk; 
+		return true; 
+	}
+	exact_insert(new_freeblk); 
+#ifdef PLACEMENT_TLSF
+	return tlsf_insert_freeblk(new_freeblk); 
+#else
+	if(GET_SIZE(HDRP(new_freeblk)) == MINI_BLK_SIZE)
+	{
+		return place_miniblk(new_freeblk); 
+	}
+	if(in_tree_class(GET_SIZE(HDRP(new_freeblk))))
+	{
+		return tree_insert_freeblk(new_freeblk); 
+	}
+	if(in_side_class(size_class(GET_SIZE(HDRP(new_freeblk)))))
+	{
+		return side_insert(new_freeblk); 
+	}
+	
+	//dbg code
+//	clock_t start, end; 
+//	double CPUtime; 
+//	start = clock();
+	//end dbg
+
+	size_t class = size_class(GET_SIZE(HDRP(new_freeblk))); 
+	char **list = &meta->freeblk_lists[class]; 
+
+	//returns false if passed block is not free
+	if(GET_ALLOC(HDRP(new_freeblk)))
+	{
+		return false; 
+	}
+	
+
+	//initialises list to first free blk if currenlty empty
+	if(*list == NULL)
+	{
+		*list = new_freeblk; 
+		SET_NEXT_FREEBLK(new_freeblk, 0x00000000);
+		SET_PREV_FREEBLK(new_freeblk, 0x00000000);
+		mark_list_nonempty(class); 
+
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("PlaceFreBlk EMPTY took: %f s\n", CPUtime);
+		//end dbg
+
+		return true; 
+	}
+
+#ifdef PLACEMENT_AOFF
+	//otherwise walk to the first blk above the new one so the list stays sorted by address, a merge always changes
+	//the size of a one size list blk so it can't take a neighbour's place in the list like splice_freeblk() does
+	freelist_iter_t it; 
+	char *prev_blk = NULL; 
+	char *next_blk; 
+	for(next_blk = freelist_begin(&it, class); next_blk != NULL && next_blk < (char *)new_freeblk; next_blk = freelist_next(&it))
+	{
+		prev_blk = next_blk; 
+	}
+	SET_PREV_FREEBLK(new_freeblk, (uint64_t)prev_blk); 
+	SET_NEXT_FREEBLK(new_freeblk, (uint64_t)next_blk); 
+	if(prev_blk != NULL)
+	{
+		SET_NEXT_FREEBLK(prev_blk, (uint64_t)new_freeblk); 
+	}
+	else
+	{
+		*list = new_freeblk; 
+	}
+	if(next_blk != NULL)
+	{
+		SET_PREV_FREEBLK(next_blk, (uint64_t)new_freeblk); 
+	}
+#else
+	//otherwise push the new freeblk at the head
+	char *comp_block = *list; 
+	*list = new_freeblk; 
+	SET_PREV_FREEBLK(new_freeblk, (uint64_t)0x00000000); 
+	SET_NEXT_FREEBLK(new_freeblk, (uint64_t)comp_block); 
+	SET_PREV_FREEBLK(comp_block, (uint64_t)new_freeblk);
+#endif
+
+	//dbg code
+//	end = clock();
+//	CPUtime = (double)((end - start));
+//	dbg_printf("PlaceFreBlk took: %f s\n", CPUtime);
+	//end dbg
+
+	return true; 
+#endif
+} 
+
+
+/*remove a free block from the freeblk list*/ 
+bool remove_freeblk(void *block_to_remove)
+{
+	if(block_to_remove == meta->wilderness)
+	{
+		meta->wilderness = NULL; 
+		return true; 
+	}
+	exact_remove(block_to_remove); 
+#ifdef PLACEMENT_TLSF
+	return tlsf_remove_freeblk(block_to_remove); 
+#else
+	if(GET_SIZE(HDRP(block_to_remove)) == MINI_BLK_SIZE)
+	{
+		return remove_miniblk(block_to_remove); 
+	}
+	if(in_tree_class(GET_SIZE(HDRP(block_to_remove))))
+	{
+		return tree_remove_freeblk(block_to_remove); 
+	}
+	if(in_side_class(size_class(GET_SIZE(HDRP(block_to_remove)))))
+	{
+		return side_remove(block_to_remove); 
+	}
+	
+	//dbg code
+//	clock_t start, end; 
+//	double CPUtime; 
+//	start = clock();
+	//end dbg
+
+	size_t class = size_class(GET_SIZE(HDRP(block_to_remove))); 
+	char **list = &meta->freeblk_lists[class]; 
+
+	//returns false if freelist is empty
+	if(*list == NULL)    
+	{
+		return false;
+	}
+	if(block_to_remove == *list)
+	{
+		//if we are removing the first and only block of the list, set the list back to empty
+		if(GET_NEXT_FREEBLK(*list) == NULL)
+		{
+			*list = NULL; 
+			mark_list_empty(class); 
+		}
+		//if we are removing the first block of the list and there are still blocks left, 
+		//set the head of the list to the second element in the list
+		else
+		{
+			SET_PREV_FREEBLK(GET_NEXT_FREEBLK(*list), 0); 
+			*list = GET_NEXT_FREEBLK(*list); 	
+
+		}
+
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("RemFreBlk FIRST took: %f s\n", CPUtime);
+		//end dbg
+
+		return true; 
+	}
+	//loop through the rest of the freelist and extract the block to remove if found
+	freelist_iter_t it; 
+	for(char *bp = freelist_begin(&it, class); bp != NULL; bp = freelist_next(&it))
+	{
+		if(bp == block_to_remove)
+		{
+			SET_NEXT_FREEBLK(GET_PREV_FREEBLK(bp), (uint64_t)it.next); 
+			if(it.next != NULL)
+			{
+				SET_PREV_FREEBLK(it.next, (uint64_t)GET_PREV_FREEBLK(bp)); 
+			}
+
+			//dbg code
+		//	end = clock();
+		//	CPUtime = (double)((end - start));
+		//	dbg_printf("RemFreBlk MID took: %f s\n", CPUtime);
+			//end dbg		
+
+			return true; 
+		}
+	}
+	
+	return false; 
+#endif
+}
+
+/*
+ * bp merges with the free blk after it into one free blk of size bytes, when both sizes share a side table
+ * bp takes over old_blk's entry in place, so the merge costs no removal and no insertion
+ * returns false if the merge has to go through remove_freeblk() and place_freeblk() instead
+ */
+static bool splice_freeblk(char *old_blk, char *bp, size_t size)
+{
+#ifdef PLACEMENT_TLSF
+	return false; 
+#else
+	size_t class = size_class(size); 
+	if(old_blk == meta->wilderness || !in_side_class(class) || size_class(GET_SIZE(HDRP(old_blk))) != class)
+	{
+		return false; 
+	}
+	side_table_t *t = side_table(class); 
+	size_t i = GET(old_blk); 
+	exact_remove(old_blk); 
+	PUT_BLK(bp, size, 0); 
+	exact_insert(bp); 
+	t->sizes[i] = size; 
+	t->addrs[i] = bp; 
+	PUT(bp, i); 
+	return true; 
+#endif
+}
+
+/*
+ * combines adjacent free blocks then places it in the appropriate free list
+ * the prev block is only looked at when the prev alloc bit of bp is clear
+ */
+void *coalesce(void *bp)
+{
+	//dbg code
+//	clock_t start, end; 
+//	double CPUtime; 
+//	start = clock();
+	//end dbg
+
+	size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+	size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+	size_t size = GET_SIZE(HDRP(bp)); 
+
+	/*Case 1: Neither blocks free*/
+	if((prev_alloc && next_alloc))
+	{
+		place_freeblk(bp); 
+
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("Coalesce NONE took: %f s\n", CPUtime);
+		//end dbg
+	}
+
+	/*Case 2: Only next block free*/ 
+	else if(prev_alloc && !next_alloc)
+	{
+		char *blk_to_remove = NEXT_BLKP(bp);
+
+		size += GET_SIZE(HDRP(blk_to_remove));
+		if(!splice_freeblk(blk_to_remove, bp, size))
+		{
+			remove_freeblk(blk_to_remove); 
+
+			PUT_BLK(bp, size, 0); 
+
+			place_freeblk(bp); 
+		}
+
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("Coalesce NEXT took: %f s\n", CPUtime);
+		//end dbg
+	}
+
+	/*Case 3: Only prev block free*/
+	else if(!prev_alloc && next_alloc)
+	{	
+		char *prevbp = PREV_BLKP(bp); 
+		size += GET_SIZE(HDRP(prevbp));
+		//a blk that becomes the top moves out of its list into the wilderness
+		if(GET_SIZE(HDRP(prevbp + size)) > 0 && stays_in_freelist(GET_SIZE(HDRP(prevbp)), size))
+		{
+			resize_listed_freeblk(prevbp, size); 
+		}
+		else
+		{
+			remove_freeblk(prevbp);
+			PUT_BLK(prevbp, size, 0); 
+			place_freeblk(prevbp);
+		}
+		bp = prevbp;
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("Coalesce PREV took: %f s\n", CPUtime);
+		//end dbg
+	}
+
+	/*Case 4: Both prev and next free*/
+	else
+	{
+		char *prevbp = PREV_BLKP(bp); 
+		size += (GET_SIZE(HDRP(prevbp)) + GET_SIZE(HDRP(NEXT_BLKP(bp)))); 
+		remove_freeblk(NEXT_BLKP(bp));
+
+		if(GET_SIZE(HDRP(prevbp + size)) > 0 && stays_in_freelist(GET_SIZE(HDRP(prevbp)), size))
+		{
+			resize_listed_freeblk(prevbp, size); 
+		}
+		else 
+		{
+			remove_freeblk(prevbp);
+			PUT_BLK(prevbp, size, 0); 
+			place_freeblk(prevbp);
+		}
+		bp = prevbp; 
+		
+		//dbg code
+	//	end = clock();
+	//	CPUtime = (double)((end - start));
+	//	dbg_printf("Coalesce PREV&NEXT took: %f s\n", CPUtime);
+		//end dbg
+	}
+
+	return bp; 
+}
+
+/*
+ * picks how much to grow the heap by to get at least bytes, a miss soon after the last one means
+ * sustained demand and doubles the chunk, a quiet spell drops it back to one CHINKSIZE
+ */
+static size_t grow_size(size_t bytes)
+{
+	if(meta->nmalloc - meta->last_grow <= GROW_WINDOW)
+	{
+		if(meta->grow_shift < GROW_MAX_SHIFT)
+		{
+			meta->grow_shift ++; 
+		}
+	}
+	else
+	{
+		meta->grow_shift = 0; 
+	}
+	meta->last_grow = meta->nmalloc; 
+
+	size_t chunk = (size_t)CHINKSIZE << meta->grow_shift; 
+	size_t cap = mm_heapsize()/GROW_HEAP_FRACTION; 
+	if(chunk > cap)
+	{
+		chunk = cap; 
+	}
+	if(chunk < bytes)
+	{
+		chunk = bytes; 
+	}
+	return (chunk + CHINKSIZE - 1) & ~(size_t)(CHINKSIZE - 1); 
+}
+
+/*extends heap by at least n bytes, grow_size() picks how much more*/ 
+void *extend_heap(size_t bytes)
+{
+	char *bp; 
+	size_t size = grow_size(bytes); 
+
+	/*a chunk that wrapped when it was rounded, or that sbrk would read as negative, can't be had*/
+	if(size < bytes || size > INTPTR_MAX)
+	{
+		return NULL; 
+	}
+
+#ifdef COMPACT_HEAP
+	/*links and header sizes of a compact heap have to stay below COMPACT_HEAP_MAX*/
+	if((size_t)((char *)mm_heap_hi() + 1 - (char *)meta) + size > COMPACT_HEAP_MAX)
+	{
+		return NULL; 
+	}
+#endif
+
+	//extends heap returning null if it fails
+	if((long)(bp = heap_sbrk(size)) == -1)
+	{
+		return NULL; 
+	}
+
+
+	/*Initialize the epilogue header then the free block header/footer, the old epilogue knows the state of the last block*/
+	PUT_HDR(HDRP(bp + size), PACK(0, 1));		//New epilogue header 
+	PUT_BLK(bp, size, 0);					//Free block header and footer
+
+	return coalesce(bp); 
+}
+
+/*
+ * bump allocates asize bytes from the low end of the wilderness, the heap is only extended by the shortfall
+ * plus whatever chunk grow_size() adds, so the rest stays on top for the next miss and for realloc to grow into
+ */
+static void *alloc_from_wilderness(size_t asize)
+{
+	char *bp = meta->wilderness; 
+	size_t have = bp ? GET_SIZE(HDRP(bp)) : 0; 
+	if(have < asize)
+	{
+		if((bp = extend_heap(asize - have)) == NULL)
+		{
+			return NULL; 
+		}
+	}
+	place(bp, asize); 
+	return bp; 
+}
+
+/*
+ * shrinks the heap with a negative sbrk when its top blk is free, keeping pad bytes of that blk
+ * returns true if anything was given back, the caller holds heap_lock
+ */
+static bool trim_heap(size_t pad)
+{
+	char *epilogue = (char *)mm_heap_hi() + 1; 
+	if(GET_PREV_ALLOC(HDRP(epilogue)))
+	{
+		return false; 
+	}
+
+	char *bp = PREV_BLKP(epilogue); 
+	size_t size = GET_SIZE(HDRP(bp)); 
+	size_t keep = pad == 0 ? 0 : align(pad); 
+	if(keep != 0 && keep < MIN_BLK_SIZE)
+	{
+		keep = MIN_BLK_SIZE; 
+	}
+	if(keep >= size)
+	{
+		return false; 
+	}
+
+	remove_freeblk(bp); 
+	if(heap_sbrk(-(intptr_t)(size - keep)) == (void *)-1)
+	{
+		place_freeblk(bp); 
+		return false; 
+	}
+	if(keep == 0)
+	{
+		/*bp's header becomes the epilogue, it already knows the blk before it*/
+		PUT_HDR(HDRP(bp), PACK(0, 1) | (GET_HDR(HDRP(bp)) & (PREV_ALLOC | PREV_MINI))); 
+	}
+	else
+	{
+		PUT_HDR(HDRP(bp + keep), PACK(0, 1)); 
+		PUT_BLK(bp, keep, 0); 
+		place_freeblk(bp); 
+	}
+	return true; 
+}
+
+/*
+ * mm_trim
+ * trim_heap() behind heap_lock, for callers outside the allocator
+ * quick listed slots, empty runs and pending blks are given back first, any of them can be all that keeps the top blk allocated
+ */
+bool mm_trim(size_t pad)
+{
+	flush_quick(); 		//takes the class locks, which come before heap_lock
+	release_empty_runs(); 
+	lock_heap(); 
+	flush_pending(); 
+	bool trimmed = trim_heap(pad); 
+	unlock_heap(); 
+	return trimmed; 
+}
+
+/*trims the heap if the free blk bp is at the top and over TRIM_THRESHOLD*/
+static void trim_top(char *bp)
+{
+	if(GET_SIZE(HDRP(bp)) > TRIM_THRESHOLD && GET_SIZE(HDRP(NEXT_BLKP(bp))) == 0)
+	{
+		trim_heap(TRIM_PAD); 
+	}
+}
+
+/*
+ * takes a pending blk that fits asize without a split, it is still marked allocated so it is handed out as is
+ * this is what lets alloc/free churn of one size skip place() and coalesce() entirely
+ */
+static char *take_pending(size_t asize)
+{
+	char **link = &meta->pending; 
+	for(char *bp = meta->pending; bp != NULL; bp = *(char **)bp)
+	{
+		size_t size = GET_SIZE(HDRP(bp)); 
+		if(size >= asize && size - asize < MIN_BLK_SIZE)
+		{
+			*link = *(char **)bp; 
+			meta->npending --; 
+			return bp; 
+		}
+		link = (char **)bp; 
+	}
+	return NULL; 
+}
+
+/*
+ * coalesces every pending blk, they are sorted by address first so runs of neighbouring pending blks
+ * are merged into one free blk before a single coalesce() with whatever surrounds them
+ */
+static void flush_pending(void)
+{
+	char *blks[PENDING_MAX + 1]; 
+	size_t n = 0; 
+	for(char *bp = meta->pending; bp != NULL; bp = *(char **)bp)
+	{
+		size_t i = n++; 
+		for(; i > 0 && blks[i - 1] > bp; i--)
+		{
+			blks[i] = blks[i - 1]; 
+		}
+		blks[i] = bp; 
+	}
+	meta->pending = NULL; 
+	meta->npending = 0; 
+
+	for(size_t i = 0; i < n; )
+	{
+		char *bp = blks[i]; 
+		size_t size = GET_SIZE(HDRP(bp)); 
+		for(i++; i < n && blks[i] == bp + size; i++)
+		{
+			size += GET_SIZE(HDRP(blks[i])); 
+		}
+		PUT_BLK(bp, size, 0); 
+		trim_top(coalesce(bp)); 
+	}
+}
+
+/*
+ * size of the top free blk a flush would leave if bp, a blk under the wilderness or the epilogue, were free:
+ * bp and the wilderness, then every blk under bp down to the first one that is neither free nor pending
+ * free blks are found through their footer and pending ones by their end, there are never many of them
+ */
+static size_t pending_top_size(char *bp)
+{
+	char *next = NEXT_BLKP(bp); 
+	size_t size = GET_SIZE(HDRP(bp)) + (next == meta->wilderness ? GET_SIZE(HDRP(next)) : 0); 
+	char *low = bp; 
+	while(true)
+	{
+		if(!GET_PREV_ALLOC(HDRP(low)))
+		{
+			low = PREV_BLKP(low); 
+			size += GET_SIZE(HDRP(low)); 
+			continue; 
+		}
+		char *pbp = meta->pending; 
+		while(pbp != NULL && pbp + GET_SIZE(HDRP(pbp)) != low)
+		{
+			pbp = *(char **)pbp; 
+		}
+		if(pbp == NULL)
+		{
+			return size; 
+		}
+		low = pbp; 
+		size += GET_SIZE(HDRP(pbp)); 
+	}
+}
+
+/*queues a freed heap blk, the header is rewritten to drop the grown bit but it stays allocated*/
+static void push_pending(char *bp)
+{
+	PUT_BLK(bp, GET_SIZE(HDRP(bp)), 1); 
+	*(char **)bp = meta->pending; 
+	meta->pending = bp; 
+	if(++meta->npending > PENDING_MAX)
+	{
+		flush_pending(); 
+	}
+}
+
+/*Maps a request size to its slab class*/
+static size_t slab_class(size_t size)
+{
+	size_t s = size < ALIGNMENT ? ALIGNMENT : align(size); 
+	if(s <= 128)
+	{
+		return s/ALIGNMENT - 1; 
+	}
+	size_t log2 = log2_floor(s - 1); 
+	return 8 + (log2 - 7)*4 + ((s - 1) >> (log2 - 2)) - 4; 
+}
+
+/*Slot size of a slab class, the largest request that maps to it*/
+static size_t slab_slot_size(size_t class)
+{
+	if(class < 8)
+	{
+		return (class + 1)*ALIGNMENT; 
+	}
+	size_t k = class - 8; 
+	return (5 + k%4) << (5 + k/4); 
+}
+
+/*Returns the run holding ptr if ptr is a slab slot, else null*/
+static run_t *find_run(void *ptr)
+{
+	run_t *run = (run_t *)((uintptr_t)ptr & ~(uintptr_t)(RUN_SIZE - 1)); 
+	if((void *)run <= mm_heap_lo() || (char *)ptr < (char *)run + RUN_HDR_SIZE)
+	{
+		return NULL; 
+	}
+	if(run->magic != (run_cookie ^ (uint64_t)run) || !(GET_HDR(HDRP(run)) & RUN_BLK))
+	{
+		return NULL; 
+	}
+	return run; 
+}
+
+/*links and unlinks a run in the list of runs with free slots of its class*/
+static void push_run(run_t *run)
+{
+	run_t **head = &meta->arenas[run->arena].slab_runs[slab_class(run->slot_size)]; 
+	run->prev = NULL; 
+	run->next = *head; 
+	if(*head)
+	{
+		(*head)->prev = run; 
+	}
+	*head = run; 
+}
+static void unlink_run(run_t *run)
+{
+	if(run->next)
+	{
+		run->next->prev = run->prev; 
+	}
+	if(run->prev)
+	{
+		run->prev->next = run->next; 
+	}
+	else
+	{
+		meta->arenas[run->arena].slab_runs[slab_class(run->slot_size)] = run->next; 
+	}
+}
+
+/*first page boundary at or after bp that leaves either no pad or a pad big enough to be a free blk*/
+static char *run_addr(char *bp)
+{
+	char *run = (char *)(((uintptr_t)bp + RUN_SIZE - 1) & ~(uintptr_t)(RUN_SIZE - 1)); 
+	if(run != bp && (size_t)(run - bp) < MIN_BLK_SIZE)
+	{
+		run += RUN_SIZE; 
+	}
+	return run; 
+}
+
+/*
+ * carves a page aligned run blk out of the free blk bp, which must have room for one after its first page boundary
+ * the pieces before and after the run go back to the free lists, they can't touch another free blk since bp didn't
+ */
+static run_t *carve_run(char *bp)
+{
+	size_t csize = GET_SIZE(HDRP(bp)); 
+	char *run = run_addr(bp); 
+	size_t pad = run - bp; 
+	size_t rsize = RUN_BLK_SIZE; 
+	size_t tail = csize - pad - rsize; 
+	if(tail < MIN_BLK_SIZE)
+	{
+		rsize += tail; 
+		tail = 0; 
+	}
+
+	remove_freeblk(bp); 
+	if(pad)
+	{
+		PUT_BLK(bp, pad, 0); 
+	}
+	PUT_BLK(run, rsize, 1 | RUN_BLK); 
+	if(tail)
+	{
+		PUT_BLK(NEXT_BLKP(run), tail, 0); 
+		place_freeblk(NEXT_BLKP(run)); 
+	}
+	if(pad)
+	{
+		place_freeblk(bp); 
+	}
+	return (run_t *)run; 
+}
+
+/*
+ * gets a new empty run for class from the free lists, or from the wilderness if nothing is big enough
+ * the heap is only extended by what the wilderness lacks to reach the next page boundary plus the run
+ */
+static run_t *new_run(arena_t *arena, size_t class)
+{
+	lock_heap(); 
+	char *bp = find_fit_given_free_list(RUN_BLK_SIZE + RUN_SIZE + MIN_BLK_SIZE); 
+	if(bp == NULL && meta->npending)
+	{
+		flush_pending(); 
+		bp = find_fit_given_free_list(RUN_BLK_SIZE + RUN_SIZE + MIN_BLK_SIZE); 
+	}
+	if(bp == NULL)
+	{
+		bp = meta->wilderness ? meta->wilderness : (char *)mm_heap_hi() + 1; 
+		size_t have = meta->wilderness ? GET_SIZE(HDRP(bp)) : 0; 
+		size_t need = run_addr(bp) - bp + RUN_BLK_SIZE; 
+		if(need > have && (bp = extend_heap(need - have)) == NULL)
+		{
+			unlock_heap(); 
+			return NULL; 
+		}
+	}
+	run_t *run = carve_run(bp); 
+	unlock_heap(); 
+	run->magic = run_cookie ^ (uint64_t)run; 
+	run->slot_size = slab_slot_size(class); 
+	run->arena = arena - meta->arenas; 
+	run->nslots = (RUN_BLK_SIZE - HSIZE - RUN_HDR_SIZE)/run->slot_size; 
+	run->nfree = run->nslots; 
+	for(size_t i = 0; i < RUN_MAX_SLOTS/64; i++)
+	{
+		run->used[i] = 0; 
+	}
+	push_run(run); 
+	return run; 
+}
+
+/*hands out the first free slot of a run of class in arena, the caller holds the class lock*/
+static void *slab_alloc(arena_t *arena, size_t class)
+{
+	run_t *run = arena->slab_runs[class]; 
+#ifndef THREAD_SAFE
+	/*threaded builds leave draining the thread cache to the heap miss path, it takes class locks of its own*/
+	if(run == NULL && flush_quick())
+	{
+		run = arena->slab_runs[class]; 
+	}
+#endif
+	if(run == NULL && (run = new_run(arena, class)) == NULL)
+	{
+		return NULL; 
+	}
+	size_t word = 0; 
+	while(run->used[word] == ~(uint64_t)0)
+	{
+		word ++; 
+	}
+	size_t slot = word*64 + __builtin_ctzl(~run->used[word]); 
+	run->used[word] |= (uint64_t)1 << (slot%64); 
+	run->nfree --; 
+	if(run->nfree == 0)
+	{
+		unlink_run(run); 
+	}
+	return (char *)run + RUN_HDR_SIZE + slot*run->slot_size; 
+}
+
+/*takes the empty run off its list and gives its blk back to the heap, the caller holds the class lock and heap_lock*/
+static void release_run(run_t *run)
+{
+	unlink_run(run); 
+	run->magic = 0; 
+	PUT_BLK(run, GET_SIZE(HDRP(run)), 0); 
+	trim_top(coalesce(run)); 
+}
+
+/*
+ * returns a slot to its run, an empty run goes back to the heap unless it is the only run of its class with room
+ * and isn't on top of the heap, so alloc/free of a single object doesn't carve and release a run every time,
+ * the caller holds the class lock
+ */
+static void slab_free(run_t *run, void *ptr)
+{
+	size_t slot = ((char *)ptr - ((char *)run + RUN_HDR_SIZE))/run->slot_size; 
+	run->used[slot/64] &= ~((uint64_t)1 << (slot%64)); 
+	run->nfree ++; 
+	if(run->nfree == 1)
+	{
+		push_run(run); 
+	}
+	if(run->nfree != run->nslots)
+	{
+		return; 
+	}
+	lock_heap(); 
+	/*a run kept at the top of the heap would hold up every trim of the free blks under it, like free() the pending*/
+	/*blks are flushed along with it when that could make a top blk trim_top() gives back*/
+	char *next = NEXT_BLKP(run); 
+	bool at_top = GET_SIZE(HDRP(next)) == 0 || next == meta->wilderness; 
+	if(run->next || run->prev || at_top)
+	{
+		bool flush = at_top && meta->npending && pending_top_size((char *)run) > TRIM_THRESHOLD; 
+		release_run(run); 
+		if(flush)
+		{
+			flush_pending(); 
+		}
+	}
+	unlock_heap(); 
+}
+
+/*gives every empty run back to the heap, the ones slab_free() kept as the last of their class with room too*/
+static void release_empty_runs(void)
+{
+	for(arena_t *arena = meta->arenas; arena < meta->arenas + NUM_ARENAS; arena++)
+	{
+		for(size_t class = 0; class < SLAB_CLASSES; class++)
+		{
+			lock_class(arena, class); 
+			run_t *run = arena->slab_runs[class]; 
+			while(run != NULL)
+			{
+				run_t *next = run->next; 
+				if(run->nfree == run->nslots)
+				{
+					lock_heap(); 
+					release_run(run); 
+					unlock_heap(); 
+				}
+				run = next; 
+			}
+			unlock_class(arena, class); 
+		}
+	}
+}
+
+/*quick list of the slot size in arena, or null if the size has none*/
+static char **quick_list(arena_t *arena, size_t slot_size)
+{
+	if(slot_size < QUICK_MIN_SIZE || slot_size > QUICK_MAX_SIZE)
+	{
+		return NULL; 
+	}
+	return &arena->quick_lists[(slot_size - QUICK_MIN_SIZE)/ALIGNMENT]; 
+}
+
+/*
+ * whether flush_quick() could give anything back, so a heap miss only drops heap_lock for it when it might
+ * in the thread safe build frees fill the thread caches and the quick lists only take slots of a thread without one
+ */
+static bool quick_held(void)
+{
+#ifdef THREAD_SAFE
+	tcache_t *tc = thread_cache; 
+	if(tc == NULL || tc->cookie != run_cookie)
+	{
+		return true; 
+	}
+	for(size_t class = 0; class < SLAB_CLASSES; class++)
+	{
+		if(tc->count[class])
+		{
+			return true; 
+		}
+	}
+	return false; 
+#else
+	return true; 
+#endif
+}
+
+/*
+ * returns every quick listed slot to its run, returns true if there were any
+ * in the thread safe build it empties this thread's cache instead, unless the thread has none
+ */
+static bool flush_quick(void)
+{
+	bool flushed = false; 
+#ifdef THREAD_SAFE
+	tcache_t *tc = thread_cache; 
+	if(tc != NULL && tc->cookie == run_cookie)
+	{
+		for(size_t class = 0; class < SLAB_CLASSES; class++)
+		{
+			if(tc->count[class])
+			{
+				tcache_drain(tc, class, 0); 
+				flushed = true; 
+			}
+		}
+		return flushed; 
+	}
+#endif
+	for(arena_t *arena = meta->arenas; arena < meta->arenas + NUM_ARENAS; arena++)
+	{
+		for(size_t i = 0; i < QUICK_CLASSES; i++)
+		{
+			size_t class = slab_class(QUICK_MIN_SIZE + i*ALIGNMENT); 
+			lock_class(arena, class); 
+			char *ptr = arena->quick_lists[i]; 
+			arena->quick_lists[i] = NULL; 
+			while(ptr != NULL)
+			{
+				char *next = *(char **)ptr; 
+				slab_free(find_run(ptr), ptr); 
+				ptr = next; 
+				flushed = true; 
+			}
+			unlock_class(arena, class); 
+		}
+	}
+	return flushed; 
+}
+
+#ifdef THREAD_SAFE
+/*gives every slot of class in tc past the first keep back to its run, locking each arena once per stretch of its slots*/
+static void tcache_drain(tcache_t *tc, size_t class, size_t keep)
+{
+	char **link = &tc->slots[class]; 
+	for(size_t i = 0; i < keep && *link != NULL; i++)
+	{
+		link = (char **)*link; 
+	}
+	char *bp = *link; 
+	*link = NULL; 
+	arena_t *locked = NULL; 
+	while(bp != NULL)
+	{
+		char *next = *(char **)bp; 
+		run_t *run = find_run(bp); 
+		arena_t *arena = &meta->arenas[run->arena]; 
+		if(arena != locked)
+		{
+			if(locked != NULL)
+			{
+				unlock_class(locked, class); 
+			}
+			lock_class(arena, class); 
+			locked = arena; 
+		}
+		slab_free(run, bp); 
+		tc->count[class] --; 
+		bp = next; 
+	}
+	if(locked != NULL)
+	{
+		unlock_class(locked, class); 
+	}
+}
+
+/*pthread destructor of a cache, its slots go back to their runs unless the heap they came from is gone*/
+static void tcache_release(void *p)
+{
+	tcache_t *tc = p; 
+	if(tc->cookie != run_cookie)
+	{
+		return; 
+	}
+	for(size_t class = 0; class < SLAB_CLASSES; class++)
+	{
+		tcache_drain(tc, class, 0); 
+	}
+	thread_cache = NULL; 
+	unmap_region(tc, sizeof(tcache_t)); 
+}
+static void tcache_make_key(void)
+{
+	pthread_key_create(&tcache_key, tcache_release); 
+}
+
+/*this thread's cache, a new one is mapped on first use and after mm_init, null if that fails*/
+static tcache_t *own_tcache(void)
+{
+	tcache_t *tc = thread_cache; 
+	if(tc != NULL && tc->cookie == run_cookie)
+	{
+		return tc; 
+	}
+	if((tc = map_region(sizeof(tcache_t))) == (void *)-1)
+	{
+		return thread_cache = NULL; 
+	}
+	tc->cookie = run_cookie; 
+	for(size_t class = 0; class < SLAB_CLASSES; class++)
+	{
+		tc->slots[class] = NULL; 
+		tc->count[class] = 0; 
+	}
+	pthread_once(&tcache_once, tcache_make_key); 
+	pthread_setspecific(tcache_key, tc); 
+	return thread_cache = tc; 
+}
+
+/*moves up to TCACHE_BATCH slots of class from this thread's arena into tc under one lock, false if it got none*/
+static bool tcache_fill(tcache_t *tc, size_t class)
+{
+	arena_t *arena = lock_own_arena(class); 
+	char **quick = quick_list(arena, slab_slot_size(class)); 
+	while(tc->count[class] < TCACHE_BATCH)
+	{
+		char *bp; 
+		if(quick != NULL && *quick != NULL)
+		{
+			bp = *quick; 
+			*quick = *(char **)bp; 
+		}
+		else if((bp = slab_alloc(arena, class)) == NULL)
+		{
+			break; 
+		}
+		*(char **)bp = tc->slots[class]; 
+		tc->slots[class] = bp; 
+		tc->count[class] ++; 
+	}
+	unlock_class(arena, class); 
+	return tc->slots[class] != NULL; 
+}
+#endif
+
+/*page rounded region length of a mapped blk, kept in the first word of the region since a compact header can't hold it*/
+static size_t map_len(void *ptr)
+{
+	return GET((char *)ptr - DSIZE); 
+}
+
+/*true for a request so large its page rounded length would wrap, no blk can ever hold it*/
+static bool too_large(size_t size)
+{
+	return size > SIZE_MAX - DSIZE - mm_pagesize(); 
+}
 
-	/*Allocate an even number of words to maintain alignment*/
-	size = align(size);
+/*maps a region of its own for a large request, the header only marks it allocated, map_len() has the length*/
+static void *map_alloc(size_t size)
+{
+	if(too_large(size))
+	{
+		return NULL; 
+	}
+	size_t len = (size + DSIZE + mm_pagesize() - 1) & ~(mm_pagesize() - 1); 
+	char *region = map_region(len); 
+	if(region == (void *)-1)
+	{
+		return NULL; 
+	}
+	PUT(region, len); 
+	PUT_HDR(HDRP(region + DSIZE), PACK(0, 1)); 
+	return region + DSIZE; 
+}
+
+/*unmaps the region of a mapped blk*/
+static void map_free(void *ptr)
+{
+	unmap_region((char *)ptr - DSIZE, map_len(ptr)); 
+}
+
+/*
+ * grows the allocated blk bp to asize without a malloc/copy/free, returns the blk or null if it can't
+ * a free next blk is absorbed, a blk at the top of the heap extends it by the shortfall,
+ * and as a last resort a free prev blk is merged and the payload moved down once
+ */
+static void *realloc_in_place(char *bp, size_t asize)
+{
+	size_t size = GET_SIZE(HDRP(bp)); 
+	char *nextbp = NEXT_BLKP(bp); 
+	size_t next_free = GET_ALLOC(HDRP(nextbp)) ? 0 : GET_SIZE(HDRP(nextbp)); 
 
-	//extends heap returning null if it fails
-	if((long)(bp = mm_sbrk(size)) == -1)
+	/*last blk, or last but a free blk: extend the heap so the free blk after bp covers the shortfall*/
+	bool at_top = GET_SIZE(HDRP(next_free ? NEXT_BLKP(nextbp) : nextbp)) == 0; 
+	if(at_top && size + next_free < asize)
 	{
-		return NULL; 
+		size_t shortfall = asize - size - next_free; 
+		if(extend_heap(shortfall < MIN_BLK_SIZE ? MIN_BLK_SIZE : shortfall) == NULL)
+		{
+			return NULL; 
+		}
+		next_free = GET_SIZE(HDRP(nextbp)); 
 	}
 
+	/*absorb the free next blk*/
+	if(size + next_free >= asize)
+	{
+		remove_freeblk(nextbp); 
+		PUT_BLK(bp, size + next_free, 1); 
+		place(bp, asize); 
+		return bp; 
+	}
 
-	/*Initialize free block header/footer and the epilogue header*/
-	PUT(HDRP(bp), PACK(size, 0));			//Free block header
-	PUT(FTRP(bp), PACK(size, 0));			//Free block footer 
-	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));	//New epilogue header 
-
-	return coalesce(bp); 
+	/*merge the free prev blk (and next) and move the payload down into it*/
+	if(!GET_PREV_ALLOC(HDRP(bp)))
+	{
+		char *prevbp = PREV_BLKP(bp); 
+		size_t total = GET_SIZE(HDRP(prevbp)) + size + next_free; 
+		if(total >= asize)
+		{
+			remove_freeblk(prevbp); 
+			if(next_free)
+			{
+				remove_freeblk(nextbp); 
+			}
+			memmove(prevbp, bp, size - HSIZE); 
+			PUT_BLK(prevbp, total, 1); 
+			place(prevbp, asize); 
+			return prevbp; 
+		}
+	}
+	return NULL; 
 }
 
 /*
@@ -770,32 +2693,75 @@ void *extend_heap(size_t bytes)
  */
 bool mm_init(void)
 {
-	/*Create initial empty heap*/
+	/*Create initial empty heap with the list heads below the prologue*/
+	if ((meta = mem_sbrk(align(sizeof(heap_meta_t)))) == (void *)-1)
+	{
+		return false; 
+	}
 	if ((heap_listp = mem_sbrk(4*WSIZE)) == (void *)-1)
 	{
 		return false; 
 	}
-	PUT(heap_listp, 0); 							//Alighment header
-	PUT(heap_listp + (WSIZE), PACK(DSIZE, 1));		//Prologue header
-	PUT(heap_listp + (2*WSIZE), PACK(DSIZE, 1)); 	//Prologue footer
-	PUT(heap_listp + (3*WSIZE), PACK(0, 1)); 		//Epilogue header
+	PUT(heap_listp, 0); 							//Alighment padding
+	heap_listp += DSIZE; //points inbetween the prologue header and footer 
+	PUT_HDR(HDRP(heap_listp), PACK(DSIZE, 1));		//Prologue header
+	PUT_HDR(FTRP(heap_listp), PACK(DSIZE, 1)); 	//Prologue footer
+	PUT_HDR(HDRP(heap_listp + DSIZE), PACK(0, 1 | PREV_ALLOC)); 		//Epilogue header
 
 	//Initialise all the list pointers, these will ALWAYS point to the beginning of the specified list
-	heap_listp += (2*WSIZE); //points inbetween the prologue header and footer 
-	freeblk_listp = heap_listp; 
-	freeblk_listp1 = heap_listp; 
-	freeblk_listp2 = heap_listp; 
-	freeblk_listp3 = heap_listp; 
-	freeblk_listp4 = heap_listp; 
-	freeblk_listp5 = heap_listp; 
-	freeblk_listp6 = heap_listp; 
-	freeblk_listp7 = heap_listp; 
-	freeblk_listp8 = heap_listp; 
-	freeblk_listp9 = heap_listp; 
-	freeblk_listp10 = heap_listp; 
-	freeblk_listp11 = heap_listp; 
-	freeblk_listp12 = heap_listp; 
-	freeblk_listp13 = heap_listp; 
+	for(size_t i = 0; i < NUM_FREELISTS; i++)
+	{
+		meta->freeblk_lists[i] = NULL; 
+	}
+	meta->nonempty_lists = 0; 
+	meta->large_tree_root = NULL; 
+	for(size_t i = 0; i < SIDE_CLASSES; i++)
+	{
+		meta->side_tables[i] = (side_table_t){NULL, NULL, 0, 0}; 
+	}
+	meta->side_scan = pick_side_scan(); 
+	for(size_t i = 0; i < EXACT_SLOTS; i++)
+	{
+		meta->exact_sizes[i] = 0; 
+		meta->exact_heads[i] = NULL; 
+	}
+	for(arena_t *arena = meta->arenas; arena < meta->arenas + NUM_ARENAS; arena++)
+	{
+		for(size_t i = 0; i < SLAB_CLASSES; i++)
+		{
+			arena->slab_runs[i] = NULL; 
+#ifdef THREAD_SAFE
+			arena->slab_locks[i].held = 0; 
+#endif
+		}
+		for(size_t i = 0; i < QUICK_CLASSES; i++)
+		{
+			arena->quick_lists[i] = NULL; 
+		}
+	}
+	meta->pending = NULL; 
+	meta->npending = 0; 
+	meta->wilderness = NULL; 
+	meta->nmalloc = 0; 
+	meta->last_grow = 0; 
+	meta->grow_shift = 0; 
+	run_cookie += RUN_MAGIC; 
+#ifdef THREAD_SAFE
+	meta->next_arena = 0; 
+	meta->heap_lock.held = 0; 
+	meta->sbrk_lock.held = 0; 
+#endif
+#ifdef PLACEMENT_TLSF
+	meta->tlsf_fl_bitmap = 0; 
+	for(size_t fl = 0; fl < TLSF_FL_COUNT; fl++)
+	{
+		meta->tlsf_sl_bitmap[fl] = 0; 
+		for(size_t sl = 0; sl < TLSF_SL_COUNT; sl++)
+		{
+			meta->tlsf_lists[fl][sl] = NULL; 
+		}
+	}
+#endif
 
 	return true;
 }
@@ -818,17 +2784,49 @@ void* malloc(size_t size)
 	{
 		return NULL; 
 	}
+#ifndef THREAD_SAFE
+	meta->nmalloc ++; 	//threaded builds only count mallocs that reach heap_lock, so the slab path writes no shared word
+#endif
 
-	/*Adjust block size to include overhead and alignment reqs*/
-	if (size <= DSIZE)
+	/*Small requests are slab slots, the hot sizes come off a quick list first*/
+	if (size <= SLAB_MAX_SIZE)
 	{
-		asize = 2*DSIZE; 
+		size_t class = slab_class(size); 
+#ifdef THREAD_SAFE
+		/*the thread's own cache first, it only goes to the arena for a batch when it runs dry*/
+		tcache_t *tc = own_tcache(); 
+		if (tc != NULL && (tc->slots[class] != NULL || tcache_fill(tc, class)))
+		{
+			bp = tc->slots[class]; 
+			tc->slots[class] = *(char **)bp; 
+			tc->count[class] --; 
+			return bp; 
+		}
+#endif
+		arena_t *arena = lock_own_arena(class); 
+		char **quick = quick_list(arena, align(size)); 
+		if (quick != NULL && *quick != NULL)
+		{
+			bp = *quick; 
+			*quick = *(char **)bp; 
+		}
+		else
+		{
+			bp = slab_alloc(arena, class); 
+		}
+		unlock_class(arena, class); 
+		return bp; 
 	}
-	else
+
+	/*Large requests get a mapping of their own*/
+	if (size > MMAP_THRESHOLD)
 	{
-		asize = align(size+DSIZE); 
+		return map_alloc(size); 
 	}
 
+	/*Adjust block size to include overhead and alignment reqs*/
+	asize = adjust_size(size); 
+
 	//dbg code	
 //	clock_t start, end; 
 //	double CPUtime; 
@@ -836,10 +2834,39 @@ void* malloc(size_t size)
 	//end dbg
 
 
-	/*Search free list for a fit if found place it in returned block*/
-	if ((bp = find_fit_given_free_list(asize)) != NULL) 
+	/*A pending blk of the right size is already allocated*/
+	lock_heap(); 
+#ifdef THREAD_SAFE
+	meta->nmalloc ++; 
+#endif
+	if ((bp = take_pending(asize)) != NULL)
 	{
-		place(bp, asize); 
+		unlock_heap(); 
+		return bp; 
+	}
+
+	/*Search free list for a fit if found place it in returned block, a miss coalesces the pending blks and looks again*/
+	bp = find_fit_given_free_list(asize); 
+	if (bp == NULL && meta->npending)
+	{
+		flush_pending(); 
+		bp = find_fit_given_free_list(asize); 
+	}
+	if (bp == NULL && quick_held())
+	{
+		/*flush_quick() takes the class locks, which come before heap_lock*/
+		unlock_heap(); 
+		bool flushed = flush_quick(); 
+		lock_heap(); 
+		if (flushed)
+		{
+			bp = find_fit_given_free_list(asize); 
+		}
+	}
+	if (bp != NULL) 
+	{
+		bp = place_fit(bp, asize); 
+		unlock_heap(); 
 
 		//dbg code
 	//	end = clock(); 
@@ -856,13 +2883,13 @@ void* malloc(size_t size)
 //	start = clock(); 
 	//end dbg
 
-	/*No fit, increase heap size to get a fit*/
-	if ((bp = extend_heap(asize)) == NULL)
+	/*No fit, take it from the top of the heap growing it if need be*/
+	bp = alloc_from_wilderness(asize); 
+	unlock_heap(); 
+	if (bp == NULL)
 	{
 		return NULL; 
 	}
-	/*place in returned freeblock form extendheap()*/
-	place(bp, asize); 
 
 	//dbg code
 //	end = clock();
@@ -887,12 +2914,60 @@ void free(void* ptr)
 	dbg_printf("calling free on blk %p w/ size = %zu\n", ptr, GET_SIZE(HDRP(ptr)));
 	//end dbg
 
-	/*change block header to portray that it is now free*/
-	size_t size = GET_SIZE(HDRP(ptr)); 
-	PUT(HDRP(ptr), PACK(size, 0)); 
-	PUT(FTRP(ptr), PACK(size, 0)); 
-	
-	coalesce(ptr); 
+	/*mapped blks live outside the heap and are unmapped*/
+	if(!in_heap(ptr))
+	{
+		map_free(ptr); 
+		return; 
+	}
+
+	/*slab slots go back to their run, in the arena the run belongs to*/
+	run_t *run = find_run(ptr); 
+	if(run != NULL)
+	{
+		size_t class = slab_class(run->slot_size); 
+#ifdef THREAD_SAFE
+		/*into this thread's cache whatever arena the slot is from, an overfull cache gives a batch back*/
+		tcache_t *tc = own_tcache(); 
+		if(tc != NULL)
+		{
+			*(char **)ptr = tc->slots[class]; 
+			tc->slots[class] = ptr; 
+			if(++tc->count[class] > TCACHE_MAX)
+			{
+				tcache_drain(tc, class, TCACHE_MAX - TCACHE_BATCH); 
+			}
+			return; 
+		}
+#endif
+		arena_t *arena = &meta->arenas[run->arena]; 
+		lock_class(arena, class); 
+		char **quick = quick_list(arena, run->slot_size); 
+		if(quick != NULL)
+		{
+			*(char **)ptr = *quick; 
+			*quick = ptr; 
+		}
+		else
+		{
+			slab_free(run, ptr); 
+		}
+		unlock_class(arena, class); 
+		return; 
+	}
+
+	/*the blk waits on the pending list, it is marked free and coalesced when the list is flushed*/
+	/*a blk at the top of the heap, or right under the wilderness, flushes it right away when that could make a top blk */
+	/*trim_top() gives back, otherwise churn at the top would split and coalesce on every round*/
+	lock_heap(); 
+	char *next = NEXT_BLKP(ptr); 
+	bool at_top = (GET_SIZE(HDRP(next)) == 0 || next == meta->wilderness) && pending_top_size(ptr) > TRIM_THRESHOLD; 
+	push_pending(ptr); 
+	if(at_top && meta->npending)
+	{
+		flush_pending(); 
+	}
+	unlock_heap(); 
 
 	//dbg code
 //	end = clock();
@@ -926,12 +3001,63 @@ void* realloc(void* oldptr, size_t size)
 		return NULL; 
 	}
 	
-	/*if block the oldptr points to is large enough, place block and return the same pointer*/ 
-	size_t asize = align(size + DSIZE); 
-	if (GET_SIZE(HDRP(oldptr)) >= asize)
+	/*mapped blks stay put while they stay large and fit their region*/
+	if (!in_heap(oldptr))
+	{
+		size_t old_payload = map_len(oldptr) - DSIZE; 
+		if (size > MMAP_THRESHOLD && size <= old_payload)
+		{
+			return oldptr; 
+		}
+		void *newptr = malloc(size); 
+		if (newptr != NULL)
+		{
+			memcpy(newptr, oldptr, size < old_payload ? size : old_payload); 
+			free(oldptr); 
+		}
+		return newptr; 
+	}
+
+	/*slab slots stay put while the new size still fits the slot*/
+	run_t *run = find_run(oldptr); 
+	if (run != NULL)
+	{
+		if (size <= run->slot_size)
+		{
+			return oldptr; 
+		}
+		void *newptr = malloc(size); 
+		if (newptr != NULL)
+		{
+			memcpy(newptr, oldptr, run->slot_size); 
+			free(oldptr); 
+		}
+		return newptr; 
+	}
+
+	/*adjust_size() would wrap on a request no blk can hold*/
+	if (too_large(size))
+	{
+		return NULL; 
+	}
+
+	/*a grown blk keeps its headroom while requests stay in its top part, anything smaller means it stopped growing*/
+	size_t asize = adjust_size(size); 
+	lock_heap(); 
+	size_t csize = GET_SIZE(HDRP(oldptr)); 
+	bool grown = GET_HDR(HDRP(oldptr)) & GROWN_BLK; 
+	if (grown && csize >= asize && asize + asize/GROW_HEADROOM >= csize)
+	{
+		unlock_heap(); 
+		return oldptr; 
+	}
+
+	/*if block the oldptr points to is large enough, place block and return the same pointer, place() clears the grown bit*/ 
+	if (csize >= asize)
 	{
 		//free(oldptr) --could cause problem when coalescing
 		place(oldptr, asize); 
+		unlock_heap(); 
 
 		//dbg code 
 	//	end = clock();
@@ -943,24 +3069,49 @@ void* realloc(void* oldptr, size_t size)
 		return oldptr; 
 	}
 
+	/*grow into the neighbours or the top of the heap if we can, that costs no copy so it takes exactly asize*/
+	void *newptr = realloc_in_place(oldptr, asize); 
+	if (newptr != NULL)
+	{
+		PUT_HDR(HDRP(newptr), GET_HDR(HDRP(newptr)) | GROWN_BLK); 
+		unlock_heap(); 
+		return newptr; 
+	}
+	unlock_heap(); 
+
+	/*a blk that has to move again gets geometric headroom so its next growth doesn't have to, unless that would wrap*/
+	size_t roomy = asize + asize/GROW_HEADROOM; 
+	if (grown && roomy > asize && !too_large(roomy))
+	{
+		asize = align(roomy); 
+	}
+
 	/*if the oldpointer does not have enough room, 
 	 * return the address of another block with enough space, 
 	 * copy the content from the oldptr to the new block and free the old block*/
-	else
+	newptr = malloc(asize - HSIZE); 
+	if (newptr == NULL)
 	{
-		void *newptr = malloc(size); 
-	    memcpy(newptr, oldptr, GET_SIZE(HDRP(oldptr))-DSIZE);	
-		free(oldptr);
-		
-		//dbg code 
-	//	end = clock();
-	//	CPUtime = (double)((end - start));
-	//	dbg_printf("Realloc NOT large enough size %ld ptr %p took: %f s\n", size, oldptr, CPUtime);
-	//	mm_checkheap(16);
-		//end dbg
+		return NULL; 
+	}
+	memcpy(newptr, oldptr, GET_SIZE(HDRP(oldptr))-HSIZE);	
+	free(oldptr);
+	if (in_heap(newptr) && find_run(newptr) == NULL)
+	{
+		/*the header also holds the prev bits the neighbour's PUT_BLK writes*/
+		lock_heap(); 
+		PUT_HDR(HDRP(newptr), GET_HDR(HDRP(newptr)) | GROWN_BLK); 
+		unlock_heap(); 
+	}
+	
+	//dbg code 
+//	end = clock();
+//	CPUtime = (double)((end - start));
+//	dbg_printf("Realloc NOT large enough size %ld ptr %p took: %f s\n", size, oldptr, CPUtime);
+//	mm_checkheap(16);
+	//end dbg
 
-		return newptr; 
-	} 
+	return newptr; 
 }
 
 /*
@@ -1001,31 +3152,138 @@ static bool aligned(const void* p)
  */
 static bool blk_in_freelist(char *blkp, char *curr_freelist_dbg)
 {
-	if(curr_freelist_dbg == heap_listp)
-	{
-		return false; 
-	}
-	char *bp; 
-	for(bp = curr_freelist_dbg; in_heap(GET_NEXT_FREEBLK(bp)); bp = GET_NEXT_FREEBLK(bp))
+	for(char *bp = curr_freelist_dbg; bp != NULL; bp = GET_NEXT_FREEBLK(bp))
 	{
 		if(blkp == bp)
 		{
 			return true; 
 		}
 	}
-	if(blkp == bp)
+	return false; 
+
+
+}
+
+/*
+ * Checks the subtree at x of the best fit tree and returns how many blks it holds
+ */
+static size_t check_tree(tnode_t *x, tnode_t *parent)
+{
+	if(x == NULL)
 	{
-		return true; 
+		return 0; 
 	}
-	return false; 
+	dbg_assert(in_heap(x));
+	dbg_assert(x->parent == parent);
+	dbg_assert(!GET_ALLOC(HDRP(x)));
+	dbg_assert(in_tree_class(GET_SIZE(HDRP(x))));
+	dbg_assert(x->left == NULL || tnode_less(x->left, x));
+	dbg_assert(x->right == NULL || tnode_less(x, x->right));
+	return 1 + check_tree(x->left, x) + check_tree(x->right, x); 
+}
+
+/*
+ * Checks every side table entry against the blk it names and returns how many blks the tables hold
+ */
+static size_t check_side_tables(void)
+{
+	size_t blks = 0; 
+	for(size_t class = NUM_LINEAR_CLASSES; class < TREE_CLASS; class++)
+	{
+		side_table_t *t = side_table(class); 
+		dbg_assert(t->count <= t->cap); 
+		dbg_assert(!t->count == !(meta->nonempty_lists & ((uint64_t)1 << class))); 
+		for(size_t i = 0; i < t->count; i++)
+		{
+			dbg_assert(in_heap(t->addrs[i]));
+			dbg_assert(!GET_ALLOC(HDRP(t->addrs[i])));
+			dbg_assert(GET_SIZE(HDRP(t->addrs[i])) == t->sizes[i]);
+			dbg_assert(size_class(t->sizes[i]) == class);
+			dbg_assert(GET(t->addrs[i]) == i);
+		}
+		blks += t->count; 
+	}
+	return blks; 
+}
 
+#ifdef DEBUG
+/*
+ * Checks every chain of the exact fit index and returns how many blks it holds
+ */
+static size_t check_exact_index(void)
+{
+	size_t blks = 0; 
+	for(size_t i = 0; i < EXACT_SLOTS; i++)
+	{
+		if(meta->exact_sizes[i] == 0)
+		{
+			dbg_assert(meta->exact_heads[i] == NULL);
+			continue; 
+		}
+		dbg_assert(exact_probe(meta->exact_sizes[i]) == i);
+		dbg_assert(meta->exact_heads[i] != NULL);
+		char *prev_bp = NULL; 
+		for(char *bp = meta->exact_heads[i]; bp != NULL; bp = exact_links(bp)[0])
+		{
+			dbg_assert(in_heap(bp));
+			dbg_assert(!GET_ALLOC(HDRP(bp)));
+			dbg_assert(bp != meta->wilderness);
+			dbg_assert(GET_SIZE(HDRP(bp)) == meta->exact_sizes[i]);
+			dbg_assert(exact_links(bp)[1] == prev_bp);
+			prev_bp = bp; 
+			blks ++; 
+		}
+	}
+	return blks; 
+}
+#endif // DEBUG
 
+#if defined(PLACEMENT_TLSF) && defined(DEBUG)
+/*
+ * Checks the TLSF bitmaps against the lists, the links and mapping of every listed blk,
+ * and that the lists hold exactly the free blks of the heap
+ */
+static bool check_tlsf(void)
+{
+	size_t freeblks_in_lists = 0; 
+	for(size_t fl = 0; fl < TLSF_FL_COUNT; fl++)
+	{
+		dbg_assert(!meta->tlsf_sl_bitmap[fl] == !(meta->tlsf_fl_bitmap & ((uint64_t)1 << fl)));
+		for(size_t sl = 0; sl < TLSF_SL_COUNT; sl++)
+		{
+			char *prev_bp = NULL; 
+			dbg_assert(!meta->tlsf_lists[fl][sl] == !(meta->tlsf_sl_bitmap[fl] & ((uint32_t)1 << sl)));
+			for(char *bp = meta->tlsf_lists[fl][sl]; bp != NULL; bp = GET_NEXT_FREEBLK(bp))
+			{
+				size_t bp_fl, bp_sl; 
+				tlsf_mapping(GET_SIZE(HDRP(bp)), &bp_fl, &bp_sl); 
+				dbg_assert(in_heap(bp));
+				dbg_assert(!GET_ALLOC(HDRP(bp)));
+				dbg_assert(bp_fl == fl && bp_sl == sl);
+				dbg_assert(GET_PREV_FREEBLK(bp) == prev_bp);
+				prev_bp = bp; 
+				freeblks_in_lists ++; 
+			}
+		}
+	}
+	size_t freeblks_in_heap = 0; 
+	for(char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	{
+		if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness)
+		{
+			freeblks_in_heap ++; 
+		}
+	}
+	dbg_printf("Ensuring same num freeblks in heap as in TLSF lists\n");
+	dbg_assert(freeblks_in_heap == freeblks_in_lists);
+	return true; 
 }
+#endif // PLACEMENT_TLSF && DEBUG
 
 /*
  * mm_checkheap
  * Lineno: 
- * 0-14  ---->  display freeblk_listp(0-6)
+ * 0-14  ---->  display freeblk_lists[lineno]
  * 15    ---->  display current state of heap
  * 16   ---->  crosscheck freelist and heap (assert)
  */
@@ -1062,76 +3320,10 @@ bool mm_checkheap(int lineno)
 	if(lineno >= 0 && lineno<15)
 	{
 			char **curr_freelist_dbg; 
-			dbg_printf("CURR FREELIST: %p\n", curr_freelist); 
-			if(lineno == 0)
-			{
-				curr_freelist_dbg = &freeblk_listp;
-				dbg_printf("FREE LIST 0: %p\n", &freeblk_listp); 
-			}
-			else if(lineno == 1)
-			{
-				curr_freelist_dbg = &freeblk_listp1;
-				dbg_printf("FREE LIST 1: %p\n", &freeblk_listp1); 
-			}	
-			else if(lineno == 2)
-			{
-				curr_freelist_dbg = &freeblk_listp2;
-				dbg_printf("FREE LIST 2: %p\n", &freeblk_listp2); 
-			}
-			else if(lineno == 3)
-			{
-				curr_freelist_dbg = &freeblk_listp3;
-				dbg_printf("FREE LIST 3: %p\n", &freeblk_listp3); 
-			}
-			else if(lineno == 4)
-			{	
-				curr_freelist_dbg = &freeblk_listp4;
-				dbg_printf("FREE LIST 4: %p\n", &freeblk_listp4); 
-			}
-			else if(lineno == 5)
-			{
-				curr_freelist_dbg = &freeblk_listp5;
-				dbg_printf("FREE LIST 5: %p\n", &freeblk_listp5); 
-			}
-			else if(lineno == 6)
-			{
-				curr_freelist_dbg = &freeblk_listp6;
-				dbg_printf("FREE LIST 6: %p\n", &freeblk_listp6); 
-			}
-			else if(lineno == 7)
-			{
-				curr_freelist_dbg = &freeblk_listp7;
-				dbg_printf("FREE LIST 7: %p\n", &freeblk_listp7); 
-			}
-			else if(lineno == 8)
-			{
-				curr_freelist_dbg = &freeblk_listp8;
-				dbg_printf("FREE LIST 8: %p\n", &freeblk_listp8); 
-			}
-			else if(lineno == 9)
-			{
-				curr_freelist_dbg = &freeblk_listp9;
-				dbg_printf("FREE LIST 9: %p\n", &freeblk_listp9); 
-			}
-			else if(lineno == 10)
-			{
-				curr_freelist_dbg = &freeblk_listp10;
-				dbg_printf("FREE LIST 10: %p\n", &freeblk_listp10); 
-			}
-			else if(lineno == 11)
-			{
-				curr_freelist_dbg = &freeblk_listp11;
-				dbg_printf("FREE LIST 11: %p\n", &freeblk_listp11); 
-			}
-			else if(lineno == 12)
-			{
-				curr_freelist_dbg = &freeblk_listp12;
-				dbg_printf("FREE LIST 12: %p\n", &freeblk_listp12); 
-			}
-			else if(lineno == 13)
+			if(lineno < NUM_FREELISTS)
 			{
-				curr_freelist_dbg = &freeblk_listp13;
-				dbg_printf("FREE LIST 13: %p\n", &freeblk_listp13); 
+				curr_freelist_dbg = &meta->freeblk_lists[lineno];
+				dbg_printf("FREE LIST %d: %p\n", lineno, &meta->freeblk_lists[lineno]); 
 			}
 			else
 			{
@@ -1141,7 +3333,7 @@ bool mm_checkheap(int lineno)
 			dbg_printf("\n"); 
 	
 			
-			if(*curr_freelist_dbg == heap_listp)
+			if(*curr_freelist_dbg == NULL)
 			{
 				dbg_printf("heap_listp = %p\n", heap_listp); 
 				dbg_printf("*curr_freelist = %p\n\n", *curr_freelist_dbg); 
@@ -1174,41 +3366,168 @@ bool mm_checkheap(int lineno)
 	//Assert: block in heap, block size appropriate for curr freelist, block is free, prev and next valid
 	if(lineno == 16)
 	{
-		unsigned long long int sizes[15] = {1, 32, 48, 64, 80, 96, 112, 128, 512, 2048, 8192, 32768, 131072, 524288, 1000000000000000000};  //half +16 half pow4
-		for(int i = 0; i<14; i++)
+		//prev bits match the previous block, free blocks have a matching footer and never touch
+		for(char *bp = heap_listp; GET_SIZE(HDRP(NEXT_BLKP(bp))) > 0; bp = NEXT_BLKP(bp))
+		{
+			char *nextbp = NEXT_BLKP(bp); 
+			dbg_assert(!GET_PREV_ALLOC(HDRP(nextbp)) == !GET_ALLOC(HDRP(bp)));
+			dbg_assert(!GET_PREV_MINI(HDRP(nextbp)) == (GET_SIZE(HDRP(bp)) != MINI_BLK_SIZE || bp == heap_listp));
+			if(!GET_ALLOC(HDRP(nextbp)) && GET_SIZE(HDRP(nextbp)) > MINI_BLK_SIZE)
+			{
+				dbg_assert(GET_SIZE(FTRP(nextbp)) == GET_SIZE(HDRP(nextbp)));
+				dbg_assert(GET_ALLOC(HDRP(bp)));
+			}
+		}
+
+		//the wilderness is the top blk whenever that one is free
+		char *epilogue = (char *)mm_heap_hi() + 1; 
+		dbg_assert(meta->wilderness == (GET_PREV_ALLOC(HDRP(epilogue)) ? NULL : PREV_BLKP(epilogue))); 
+
+		//runs: page aligned with a valid magic, free count matches the slot bitmap, and exactly the runs with room are listed
+		size_t partial_runs = 0; 
+		for(char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+		{
+			if(!(GET_HDR(HDRP(bp)) & RUN_BLK))
+			{
+				continue; 
+			}
+			run_t *run = (run_t *)bp; 
+			size_t used_slots = 0; 
+			for(size_t i = 0; i < RUN_MAX_SLOTS/64; i++)
+			{
+				used_slots += __builtin_popcountl(run->used[i]); 
+			}
+			dbg_assert(find_run(bp + RUN_HDR_SIZE) == run); 
+			dbg_assert((size_t)run->nslots*run->slot_size + RUN_HDR_SIZE <= GET_SIZE(HDRP(bp)) - HSIZE); 
+			dbg_assert(used_slots + run->nfree == run->nslots && run->arena < NUM_ARENAS); 
+			partial_runs += (run->nfree > 0); 
+		}
+		size_t listed_runs = 0; 
+		for(size_t a = 0; a < NUM_ARENAS; a++)
+		{
+			for(size_t i = 0; i < SLAB_CLASSES; i++)
+			{
+				for(run_t *run = meta->arenas[a].slab_runs[i]; run != NULL; run = run->next)
+				{
+					dbg_assert(run->nfree > 0 && slab_class(run->slot_size) == i && run->arena == a); 
+					dbg_assert(run->next == NULL || run->next->prev == run); 
+					listed_runs ++; 
+				}
+			}
+		}
+		dbg_printf("Checking %zu runs with free slots are all listed\n", partial_runs); 
+		dbg_assert(listed_runs == partial_runs); 
+
+		//pending blks are heap blks still marked allocated, and there are never more than PENDING_MAX of them
+		size_t pending_blks = 0; 
+		for(char *bp = meta->pending; bp != NULL; bp = *(char **)bp)
+		{
+			dbg_assert(in_heap(bp) && GET_ALLOC(HDRP(bp)) && !(GET_HDR(HDRP(bp)) & RUN_BLK)); 
+			pending_blks ++; 
+		}
+		dbg_assert(pending_blks == meta->npending && pending_blks <= PENDING_MAX); 
+
+		//quick listed slots belong to a run of their size in the same arena and are still marked used in it
+		for(arena_t *arena = meta->arenas; arena < meta->arenas + NUM_ARENAS; arena++)
+		{
+			for(size_t i = 0; i < QUICK_CLASSES; i++)
+			{
+				for(char *ptr = arena->quick_lists[i]; ptr != NULL; ptr = *(char **)ptr)
+				{
+					run_t *run = find_run(ptr); 
+					dbg_assert(run != NULL && quick_list(&meta->arenas[run->arena], run->slot_size) == &arena->quick_lists[i]); 
+					size_t slot = (ptr - ((char *)run + RUN_HDR_SIZE))/run->slot_size; 
+					dbg_assert(run->used[slot/64] & ((uint64_t)1 << (slot%64))); 
+				}
+			}
+		}
+		//exact fit index: chains are consistent and hold every indexed free blk
+		size_t exact_freeblks_in_heap = 0; 
+		for(char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+		{
+			if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness && in_exact_range(GET_SIZE(HDRP(bp))) && exact_links(bp)[0] != bp)
+			{
+				exact_freeblks_in_heap ++; 
+			}
+		}
+		dbg_printf("Checking exact fit index holds %zu blks\n", exact_freeblks_in_heap); 
+		dbg_assert(check_exact_index() == exact_freeblks_in_heap); 
+#ifdef PLACEMENT_TLSF
+		return check_tlsf(); 
+#endif
+		//large blks: tree is ordered, links are consistent and it holds every large free blk
+		size_t large_freeblks_in_heap = 0; 
+		for(char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+		{
+			if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness && in_tree_class(GET_SIZE(HDRP(bp))))
+			{
+				large_freeblks_in_heap ++; 
+			}
+		}
+		dbg_printf("Checking best fit tree holds %zu blks\n", large_freeblks_in_heap); 
+		dbg_assert(check_tree(meta->large_tree_root, NULL) == large_freeblks_in_heap); 
+		dbg_assert(!meta->large_tree_root == !(meta->nonempty_lists & ((uint64_t)1 << TREE_CLASS))); 
+
+		//mixed size blks: every entry names its blk and the tables hold every such free blk
+		size_t side_freeblks_in_heap = 0; 
+		for(char *bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+		{
+			if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness && in_side_class(size_class(GET_SIZE(HDRP(bp)))))
+			{
+				side_freeblks_in_heap ++; 
+			}
+		}
+		dbg_printf("Checking side tables hold %zu blks\n", side_freeblks_in_heap); 
+		dbg_assert(check_side_tables() == side_freeblks_in_heap); 
+
+		for(size_t i = 0; i<NUM_FREELISTS && i<TREE_CLASS; i++)
 		{	
-			char **curr_freelist_dbg = find_free_list(sizes[i]); 
-			dbg_printf("Cheking FreeList: %d: %p\n", i, *curr_freelist_dbg); 
-			if(*curr_freelist_dbg == heap_listp)
+			if(in_side_class(i))
+			{
+				continue; 
+			}
+			char **curr_freelist_dbg = &meta->freeblk_lists[i]; 
+			dbg_printf("Cheking FreeList: %zu: %p\n", i, *curr_freelist_dbg); 
+			if(*curr_freelist_dbg == NULL)
 			{
 				dbg_printf("List empty, checking if freelist is initialised properly\n\n");
-				dbg_assert(GET_NEXT_FREEBLK(*curr_freelist_dbg) == NULL);
-				dbg_assert(GET_PREV_FREEBLK(*curr_freelist_dbg) == NULL); 
+				dbg_assert(!(meta->nonempty_lists & ((uint64_t)1 << i)));
 				continue; 
 			}
 
+			dbg_printf("Checking list %zu is marked nonempty\n", i); 
+			dbg_assert(meta->nonempty_lists & ((uint64_t)1 << i));
+
+			//mini blocks have no prev link to check
+			bool mini_list = (i == size_class(MINI_BLK_SIZE)); 
 			char *bp = *curr_freelist_dbg; 
 			char *prev_bp = NULL; 
 			int freeblks_in_freelist = 1;
 			for(bp = *curr_freelist_dbg; in_heap(GET_NEXT_FREEBLK(bp)); bp = GET_NEXT_FREEBLK(bp))
 			{
 				dbg_printf("Checking freeblk size and alloc of block %p\n", bp); 
-				dbg_assert(sizes[i] <= GET_SIZE(HDRP(bp)) && GET_SIZE(HDRP(bp)) < sizes[i+1]); 
+				dbg_assert(size_class(GET_SIZE(HDRP(bp))) == i); 
 				dbg_assert(!GET_ALLOC(HDRP(bp)));
 
 				dbg_printf("Checking prev freeblk = %p of curr freeblk equals actual prev blk = %p\n", GET_PREV_FREEBLK(bp), prev_bp); 
-				dbg_assert(GET_PREV_FREEBLK(bp) == prev_bp); 
+				dbg_assert(mini_list || GET_PREV_FREEBLK(bp) == prev_bp); 
+#ifdef PLACEMENT_AOFF
+				dbg_assert(mini_list || prev_bp == NULL || prev_bp < bp); 
+#endif
 				prev_bp = bp; 
 				freeblks_in_freelist ++;
 			}
 			dbg_printf("Checking last block of freelist\n"); 
 
 			dbg_printf("Checking freeblk size and alloc of block %p\n", bp); 
-			dbg_assert(GET_PREV_FREEBLK(bp) == prev_bp);
+			dbg_assert(mini_list || GET_PREV_FREEBLK(bp) == prev_bp);
+#ifdef PLACEMENT_AOFF
+			dbg_assert(mini_list || prev_bp == NULL || prev_bp < bp); 
+#endif
 			dbg_assert(!GET_ALLOC(HDRP(bp)));
 			
 			dbg_printf("Checking prev freeblk = %p of curr freeblk equals actual prev blk = %p\n", GET_PREV_FREEBLK(bp), prev_bp); 
-			dbg_assert(sizes[i] <= GET_SIZE(HDRP(bp)) && GET_SIZE(HDRP(bp)) < sizes[i+1]); 
+			dbg_assert(size_class(GET_SIZE(HDRP(bp))) == i); 
 
 			dbg_printf("Checking nextblk of last block: %p is NULL\n", bp); 
 			dbg_assert(GET_NEXT_FREEBLK(bp) == NULL); 
@@ -1219,16 +3538,16 @@ bool mm_checkheap(int lineno)
 			int freeblks_in_heap = 0;
 			for(bp = heap_listp; in_heap(NEXT_BLKP(bp)); bp = NEXT_BLKP(bp))
 			{
-				if(!GET_ALLOC(HDRP(bp)) && sizes[i] <= GET_SIZE(HDRP(bp)) && GET_SIZE(HDRP(bp)) < sizes[i+1])
+				if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness && size_class(GET_SIZE(HDRP(bp))) == i)
 				{
-					dbg_printf("Checking freeblk %p is in freelist %i, %p\n", bp, i, *curr_freelist_dbg); 
+					dbg_printf("Checking freeblk %p is in freelist %zu, %p\n", bp, i, *curr_freelist_dbg); 
 					dbg_assert(blk_in_freelist(bp, *curr_freelist_dbg));
 					freeblks_in_heap ++;
 				}
 			}
-			if(!GET_ALLOC(HDRP(bp)) && sizes[i] <= GET_SIZE(HDRP(bp)) && GET_SIZE(HDRP(bp)) < sizes[i+1])
+			if(!GET_ALLOC(HDRP(bp)) && bp != meta->wilderness && size_class(GET_SIZE(HDRP(bp))) == i)
 			{
-				dbg_printf("Checking freeblk %p is in freelist %i, %p\n", bp, i, *curr_freelist_dbg); 
+				dbg_printf("Checking freeblk %p is in freelist %zu, %p\n", bp, i, *curr_freelist_dbg); 
 				dbg_assert(blk_in_freelist(bp, *curr_freelist_dbg));
 				freeblks_in_heap ++;
 			}
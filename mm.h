@@ -21,5 +21,8 @@ extern void *calloc (size_t nmemb, size_t size);
 
 extern bool mm_init(void);
 
+/* Gives the free top of the heap back to memlib, keeping pad bytes of it */
+extern bool mm_trim(size_t pad);
+
 /* This is for debugging.  Returns false if error encountered */
 extern bool mm_checkheap(int lineno);
@@ -0,0 +1,84 @@
+/*
+ * scanbench - times the side table fit scan of mm.c against table length
+ *
+ * Every scan kernel the CPU supports is run over a table of sizes that all miss,
+ * so each call walks the whole table, which is the worst case of a fit search.
+ * mm.c is compiled in whole so its static kernels can be called directly,
+ * which also turns malloc and free into the mm_ versions, so the table is static.
+ */
+#include "mm.c"
+#include "fcyc.h"
+
+#define SCAN_REPS 1000		//scans per timed call, so the timer overhead is spread thin
+#define SCAN_MAX 4096		//longest table timed
+
+typedef struct
+{
+	side_scan_fn scan;
+	const uint64_t *sizes;
+	size_t n;
+	uint64_t asize;
+	size_t found; 			//Kept so the scans are not optimised away
+} scan_args_t;
+
+static uint64_t sizes[SCAN_MAX];
+
+static void run_scan(void *argp)
+{
+	scan_args_t *args = argp;
+	size_t found = 0;
+	for(int r = 0; r < SCAN_REPS; r++)
+	{
+		found += args->scan(args->sizes, args->n, args->asize);
+	}
+	args->found = found;
+}
+
+int main(void)
+{
+	/*sizes of a mixed class, every one of them smaller than the request*/
+	for(size_t i = 0; i < SCAN_MAX; i++)
+	{
+		sizes[i] = LINEAR_CLASS_LIMIT + ALIGNMENT*(i % 16);
+	}
+	uint64_t asize = LINEAR_CLASS_LIMIT + ALIGNMENT*16;
+
+	const char *names[3] = {"scalar", "sse4.2", "avx2"};
+	side_scan_fn kernels[3] = {side_scan_scalar, NULL, NULL};
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2"))
+	{
+		kernels[1] = side_scan_sse42;
+	}
+	if(__builtin_cpu_supports("avx2"))
+	{
+		kernels[2] = side_scan_avx2;
+	}
+#endif
+
+	printf("cycles per scan of a table where nothing fits\n");
+	printf("%8s", "entries");
+	for(int k = 0; k < 3; k++)
+	{
+		printf("%12s", names[k]);
+	}
+	printf("\n");
+	for(size_t n = 1; n <= SCAN_MAX; n *= 2)
+	{
+		printf("%8zu", n);
+		for(int k = 0; k < 3; k++)
+		{
+			if(kernels[k] == NULL)
+			{
+				printf("%12s", "-");
+				continue;
+			}
+			scan_args_t args = {kernels[k], sizes, n, asize, 0};
+			double cycles = fcyc(run_scan, &args)/SCAN_REPS;
+			printf("%12.1f", cycles);
+		}
+		printf("\n");
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * threadbench - times mm.c built with THREAD_SAFE as more threads share it
+ *
+ * Every thread keeps its own set of live blks and replaces a random one on each step, mostly small
+ * requests that stay on their slab class lock with a share of heap sized ones that take heap_lock and
+ * a few mapped ones that only take sbrk_lock. Each blk is stamped with its owner and slot and the stamp
+ * is checked before it is freed, so two threads handed the same memory show up as a failure.
+ * mm.c is compiled in whole with THREAD_SAFE on, so every thread works on the one heap it sets up, quietly.
+ */
+#include "mm.c"
+#include <pthread.h>
+#include <time.h>
+
+#define BENCH_OPS 1000000		//malloc/free pairs per thread
+#define BENCH_LIVE 512			//blks each thread keeps live
+#define BENCH_MAX_THREADS 16
+
+typedef struct
+{
+	pthread_t tid;
+	uint64_t id;
+	uint64_t seed;
+	uint64_t errors;
+} bench_thread_t;
+
+static void *live[BENCH_MAX_THREADS][BENCH_LIVE];
+
+/*xorshift, so threads don't share the state of rand()*/
+static uint64_t next_rand(uint64_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 7;
+	*seed ^= *seed << 17;
+	return *seed;
+}
+
+/*15 in 16 requests are slab sized, most of the rest heap sized and 1 in 4096 mapped*/
+static size_t bench_size(uint64_t r)
+{
+	if(r % 4096 == 0)
+	{
+		return MMAP_THRESHOLD + (r >> 20) % MMAP_THRESHOLD;
+	}
+	if(r % 16 == 0)
+	{
+		return SLAB_MAX_SIZE + 1 + (r >> 12) % 4096;
+	}
+	return 1 + (r >> 12) % SLAB_MAX_SIZE;
+}
+
+static void *run_thread(void *argp)
+{
+	bench_thread_t *t = argp;
+	void **mine = live[t->id];
+	for(size_t op = 0; op < BENCH_OPS; op++)
+	{
+		uint64_t r = next_rand(&t->seed);
+		size_t slot = r % BENCH_LIVE;
+		if(mine[slot] != NULL)
+		{
+			if(*(uint64_t *)mine[slot] != (t->id << 32 | slot))
+			{
+				t->errors ++;
+			}
+			free(mine[slot]);
+		}
+		mine[slot] = malloc(bench_size(r >> 9));
+		if(mine[slot] == NULL)
+		{
+			t->errors ++;
+			continue;
+		}
+		*(uint64_t *)mine[slot] = t->id << 32 | slot;
+	}
+	for(size_t slot = 0; slot < BENCH_LIVE; slot++)
+	{
+		free(mine[slot]);
+		mine[slot] = NULL;
+	}
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(void)
+{
+	bench_thread_t threads[BENCH_MAX_THREADS];
+	mem_init();
+
+	printf("%d arenas\n", NUM_ARENAS);
+	printf("%8s%14s%18s\n", "threads", "Mops/sec", "Mops/sec/thread");
+	for(size_t n = 1; n <= BENCH_MAX_THREADS; n *= 2)
+	{
+		mem_reset_brk();
+		if(!mm_init())
+		{
+			fprintf(stderr, "mm_init failed\n");
+			return 1;
+		}
+		double start = now();
+		for(size_t i = 0; i < n; i++)
+		{
+			threads[i] = (bench_thread_t){0, i, 0x9e3779b97f4a7c15 * (i + 1), 0};
+			pthread_create(&threads[i].tid, NULL, run_thread, &threads[i]);
+		}
+		uint64_t errors = 0;
+		for(size_t i = 0; i < n; i++)
+		{
+			pthread_join(threads[i].tid, NULL);
+			errors += threads[i].errors;
+		}
+		double mops = 2.0*BENCH_OPS*n/(now() - start)/1e6;
+		printf("%8zu%14.1f%18.1f\n", n, mops, mops/n);
+		if(errors)
+		{
+			printf("%lu blks were lost or overwritten\n", (unsigned long)errors);
+			return 1;
+		}
+	}
+	return 0;
+}